@@ -14,7 +14,7 @@ LOCAL_C_INCLUDES := $(LOCAL_PATH)/$(SDL_PATH)/include
 
 # Add your application source files here...
 LOCAL_SRC_FILES := window.c graphicsUtils.c console.c audio.c resources.c archive.c \
-  value.c httpRequest.c external/miniz.c graphics.c log.c \
+  value.c httpRequest.c external/miniz.c graphics.c log.c transf2d.c raster.c profiler.c \
   arcajs.c graphicsBindings.c jsBindings.c \
   modules/intersects.c modules/intersectsBindings.c external/duktape.c
 
@@ -2,6 +2,7 @@
 #include "graphics.h"
 #include "audio.h"
 #include "console.h"
+#include "profiler.h"
 #include "resources.h"
 #include "jsBindings.h"
 #include "value.h"
@@ -19,6 +20,7 @@
 
 const char* appVersion = "v0.20251130a";
 int debug = 0, useJoystickApi = 0;
+static uint32_t benchFrames = 0; ///< number of frames to run in benchmark mode, 0 if disabled
 
 static void onDebugSession(int evt) {
 	if(evt == DUKT_DEBUG_EVENT_QUIT)
@@ -34,6 +36,8 @@ static void showError(const char* msg, ...) {
 	vsnprintf(formattedMsg, 1024, msg, argptr);
 	va_end(argptr);
 	fprintf(stderr, "%s\n", formattedMsg);
+	if(benchFrames) // never block unattended benchmark runs
+		return;
 
 	if(!WindowIsOpen()) {
 		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "arcajs Error", formattedMsg, NULL);
@@ -380,6 +384,12 @@ int handleEvents(void* udata) {
 		SDL_free(fname);
 		break;
 	}
+#ifndef _GRAPHICS_GL
+	case SDL_RENDER_TARGETS_RESET:
+	case SDL_RENDER_DEVICE_RESET: // render target contents are lost
+		gfxLayersInvalidate();
+		break;
+#endif
 	case SDL_QUIT:
 		ret = 1;
 		break;
@@ -387,6 +397,102 @@ int handleEvents(void* udata) {
 	return ret;
 }
 
+//--- benchmark ----------------------------------------------------
+
+/// per phase durations in milliseconds as timed by the profiler, one sample per benchmark frame
+static float* benchSamples[PROF_NUM_PHASES];
+static uint32_t benchFrame = 0;
+
+static void benchInit(uint32_t numFrames) {
+	benchFrames = numFrames;
+	benchFrame = 0;
+	for(int i=0; i<PROF_NUM_PHASES; ++i)
+		benchSamples[i] = (float*)calloc(numFrames, sizeof(float));
+}
+
+/// records the profiled phases of the completed frame, returns true after the last one
+static bool benchFrameEnd() {
+	if(!benchFrames)
+		return false;
+	for(int i=0; i<PROF_NUM_PHASES; ++i) {
+		ProfilerStat stat;
+		ProfilerStats(i, &stat);
+		benchSamples[i][benchFrame] = stat.last;
+	}
+	return ++benchFrame >= benchFrames;
+}
+
+static int benchCompare(const void* a, const void* b) {
+	const float fa = *(const float*)a, fb = *(const float*)b;
+	return (fa > fb) - (fa < fb);
+}
+
+/// returns the nearest-rank percentile p of n sorted samples
+static float benchPercentile(const float* sorted, uint32_t n, float p) {
+	uint32_t rank = (uint32_t)ceilf(p*n);
+	return sorted[rank ? rank-1 : 0];
+}
+
+/// prints min/median/p95/p99/mean per phase as text to stdout and as JSON to stdout or jsonFileName
+static void benchReport(const char* name, const char* jsonFileName) {
+	FILE* json = jsonFileName ? fopen(jsonFileName, "w") : stdout;
+	if(!json) {
+		fprintf(stderr, "cannot write benchmark results to \"%s\"\n", jsonFileName);
+		json = stdout;
+	}
+	const uint32_t n = benchFrame;
+	char jsonPhases[PROF_NUM_PHASES][192];
+	printf("benchmark %s: %u frames\n", name, n);
+	printf("%-10s %9s %9s %9s %9s %9s\n", "phase [ms]", "min", "median", "p95", "p99", "mean");
+	for(int i=0; i<PROF_NUM_PHASES; ++i) {
+		float* sorted = benchSamples[i];
+		double sum = 0.0;
+		for(uint32_t j=0; j<n; ++j)
+			sum += sorted[j];
+		qsort(sorted, n, sizeof(float), benchCompare);
+		const float min = n ? sorted[0] : 0.0f, median = n ? benchPercentile(sorted, n, 0.5f) : 0.0f;
+		const float p95 = n ? benchPercentile(sorted, n, 0.95f) : 0.0f, p99 = n ? benchPercentile(sorted, n, 0.99f) : 0.0f;
+		const float mean = n ? sum/n : 0.0f;
+		printf("%-10s %9.3f %9.3f %9.3f %9.3f %9.3f\n", ProfilerName(i), min, median, p95, p99, mean);
+		snprintf(jsonPhases[i], sizeof(jsonPhases[i]),
+			"\"%s\":{\"min\":%.4f,\"median\":%.4f,\"p95\":%.4f,\"p99\":%.4f,\"mean\":%.4f}",
+			ProfilerName(i), min, median, p95, p99, mean);
+		free(benchSamples[i]);
+		benchSamples[i] = NULL;
+	}
+	fprintf(json, "{\"name\":\"");
+	for(const char* c = name; *c; ++c) {
+		if(*c=='"' || *c=='\\')
+			fputc('\\', json);
+		fputc(*c, json);
+	}
+	fprintf(json, "\",\"version\":\"%s\",\"frames\":%u,\"unit\":\"ms\",\"phases\":{", appVersion, n);
+	for(int i=0; i<PROF_NUM_PHASES; ++i)
+		fprintf(json, "%s%s", i ? "," : "", jsonPhases[i]);
+	fprintf(json, "}}\n");
+	if(json != stdout)
+		fclose(json);
+	benchFrames = 0;
+}
+
+//--- profiling ----------------------------------------------------
+
+/// passes the counters of the completed frame and by how many seconds it missed its deadline to the profiler
+static void profilerCounters(size_t vm, double deadlineMiss) {
+	uint32_t drawCalls, textureSwitches, vertices, jsAllocs;
+	size_t jsHeap;
+	gfxRenderCounters(&drawCalls, &textureSwitches, &vertices);
+	jsvmHeapCounters(vm, &jsHeap, &jsAllocs);
+	ProfilerCount(PROF_DRAW_CALLS, drawCalls);
+	ProfilerCount(PROF_TEXTURE_SWITCHES, textureSwitches);
+	ProfilerCount(PROF_VERTICES, vertices);
+	ProfilerCount(PROF_AUDIO, AudioCallbackTime()*1000.0);
+	ProfilerCount(PROF_JS_ALLOCS, jsAllocs);
+	ProfilerCount(PROF_JS_HEAP, jsHeap/1024.0);
+	ProfilerCount(PROF_DEADLINE_MISS, deadlineMiss*1000.0);
+	ProfilerCount(PROF_PIPELINE_STALLS, gfxPipelineStalls());
+}
+
 #if defined __WIN32__ || defined WIN32
 #define PATHSEP '\\'
 #else
@@ -399,8 +505,13 @@ int main(int argc, char **argv) {
 	char* windowTitle = NULL;
 	char* storageFileName = NULL;
 	char* iconName = NULL;
-	bool isCalledWithScript = false, hasWindow = true;
+	bool isCalledWithScript = false, hasWindow = true, deferredDraw = false, pipelinedDraw = false, atlasPacking = false;
+	bool fontSDF = false, svgCacheCompress = true;
+	unsigned svgCacheSize = 64; // MiB
+	int stateStackDepth = 64, rasterThreads = 0;
 	double maxFps = 0.0, pixelRatio = 0.0;
+	uint32_t numBenchFrames = 0;
+	const char* benchJsonName = NULL;
 	Value* args = NULL;
 
 	int winSzX = 640, winSzY = 480, windowFlags = WINDOW_VSYNC;
@@ -440,6 +551,16 @@ int main(int argc, char **argv) {
 			winSzY = atoi(argv[i+1]);
 		else if(strcmp(argv[i],"-m")==0 && i+1<argc)
 			maxFps = atof(argv[i+1]);
+		else if(strcmp(argv[i],"--raster")==0 && i+1<argc)
+			rasterThreads = atoi(argv[i+1]);
+		else if(strcmp(argv[i],"--pipelined")==0)
+			pipelinedDraw = true;
+		else if(strcmp(argv[i],"--stats")==0)
+			ConsoleStatsVisible(1);
+		else if(strcmp(argv[i],"--bench")==0 && i+1<argc)
+			numBenchFrames = atoi(argv[i+1]);
+		else if(strcmp(argv[i],"--bench-json")==0 && i+1<argc)
+			benchJsonName = argv[i+1];
 		else if(strcmp(argv[i],"--version")==0) {
 			printf("%s\n", appVersion);
 			return 0;
@@ -508,6 +629,16 @@ int main(int argc, char **argv) {
 		audioTracks = jsonGetNumber(json, "audio_tracks", audioTracks);
 		scriptNames = jsonGetStringArray(json, "scripts");
 		maxFps = jsonGetNumber(json, "max_fps", maxFps);
+		deferredDraw = jsonGetNumber(json, "deferred_draw", deferredDraw);
+		atlasPacking = jsonGetNumber(json, "atlas_packing", atlasPacking);
+		stateStackDepth = jsonGetNumber(json, "state_stack_depth", stateStackDepth);
+		fontSDF = jsonGetNumber(json, "font_sdf", fontSDF);
+		svgCacheSize = jsonGetNumber(json, "svg_cache_size", svgCacheSize);
+		svgCacheCompress = jsonGetNumber(json, "svg_cache_compress", svgCacheCompress);
+		if(!rasterThreads)
+			rasterThreads = jsonGetNumber(json, "raster_threads", rasterThreads);
+		if(!pipelinedDraw)
+			pipelinedDraw = jsonGetNumber(json, "pipelined_draw", pipelinedDraw);
 
 		{
 			char* display = jsonGetString(json, "display");
@@ -534,6 +665,12 @@ int main(int argc, char **argv) {
 		free(manifest);
 		manifest = NULL;
 	}
+	ResourceAtlasPacking(atlasPacking);
+	ResourceFontSDF(fontSDF);
+	if(numBenchFrames) { // run as fast as possible, offscreen and without vsync
+		maxFps = 0.0;
+		windowFlags = (windowFlags & ~(WINDOW_VSYNC|WINDOW_FULLSCREEN)) | WINDOW_HEADLESS;
+	}
 
 	// initialize window and video:
 	hasWindow = winSzX>0 && winSzY>0;
@@ -564,6 +701,7 @@ int main(int argc, char **argv) {
 		strcat(strcat(strcat(storageFileName, storagePath), storageBaseName),".json");
 		free(storageBaseName);
 	}
+	ResourceSVGCache(storagePath, (size_t)svgCacheSize<<20, svgCacheCompress);
 	SDL_free((void*)storagePath);
 
 	Value* events = Value_new(VALUE_LIST, NULL);
@@ -574,7 +712,12 @@ int main(int argc, char **argv) {
 #ifdef _GRAPHICS_GL
 		gfxInit(winSzX, winSzY, windowPerspectivity, pixelRatio, SDL_GL_GetProcAddress);
 #else
+		gfxSoftwareRasterizer(rasterThreads);
 		gfxInit(winSzX, winSzY, pixelRatio, WindowRenderer());
+		gfxDeferredRendering(deferredDraw);
+		if(pipelinedDraw)
+			gfxPipelinedRendering(true);
+		gfxStateStackDepth(stateStackDepth);
 #endif
 		if(consoleSzY)
 			ConsoleCreate(0,0,consoleY, winSzX, consoleSzY);
@@ -599,6 +742,8 @@ int main(int argc, char **argv) {
 	windowTitle = NULL;
 
 	if(hasWindow) {
+		if(numBenchFrames)
+			SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
 		AudioOpen(audioFrequency, audioTracks);
 		if(useJoystickApi>=0) // useJoystickApi < 0 disables joystick input completely
 			for(size_t i=0, end = WindowNumControllers(); i<end; ++i)
@@ -639,73 +784,98 @@ int main(int argc, char **argv) {
 	jsvmDispatchEvent(vm, "load", NULL);
 
 	// main loop:
+	WindowFramePacing(maxFps);
 	Value* argUpdate = Value_float(0.0);
 	argUpdate->next = Value_float(0.0);
 	if(hasWindow) {
+		if(numBenchFrames)
+			benchInit(numBenchFrames);
 		while(WindowIsOpen()) {
 			if (debug_port > 0)
 				dukt_debug_poll();
+			ProfilerFrameStart();
 			const double now = WindowTimestamp();
 			jsvmUpdateEventListeners(vm);
+			ProfilerPhase(PROF_LISTENERS);
 			jsvmAsyncCalls(vm, now);
+			ProfilerPhase(PROF_ASYNC);
 			argUpdate->f = WindowDeltaT();
 			argUpdate->next->f = now;
 			jsvmDispatchGamepadEvents(vm);
 			jsvmDispatchEvent(vm, "update", argUpdate);
+			ProfilerPhase(PROF_UPDATE);
 			gfxBeginFrame(WindowGetClearColor());
 			jsvmDispatchDrawEvent(vm);
 			if(consoleSzY)
 				ConsoleDraw();
-			gfxEndFrame();
+			ConsoleDrawStats();
+			gfxFinishFrame();
+			ProfilerPhase(PROF_DRAW);
+			gfxPresent();
+			ProfilerPhase(PROF_PRESENT);
 			if(WindowUpdate()!=0) // swap buffers
 				break;
 
 			for(Value* evt = events->child; evt!=NULL; evt = evt->next)
 				jsvmDispatchEvent(vm, Value_get(evt, "evt")->str, evt);
+			ProfilerPhase(PROF_EVENTS);
 			if(jsvmLastError(vm)) {
 				showError("JavaScript ERROR: %s\n", jsvmLastError(vm));
 				break;
 			}
-			if(maxFps) {
-				const double deltaT = (double)SDL_GetTicks64()/1000.0 - now;
-				const double delay = 1000.0/maxFps - 1000.0*deltaT;
-				if(delay>1.0)
-					SDL_Delay(delay);
-			}
+			profilerCounters(vm, WindowPaceFrame());
+			ProfilerFrameEnd();
+			if(benchFrameEnd())
+				break;
 		}
 	}
 	else {
 		SDL_InitSubSystem(SDL_INIT_EVENTS|SDL_INIT_TIMER);
+		if(numBenchFrames)
+			benchInit(numBenchFrames);
 		bool running = true;
 		while(running) {
 			if (debug_port > 0)
 				dukt_debug_poll();
+			ProfilerFrameStart();
 			WindowUpdateTimestamp();
 			const double now = WindowTimestamp();
 			jsvmUpdateEventListeners(vm);
+			ProfilerPhase(PROF_LISTENERS);
 			jsvmAsyncCalls(vm, now);
+			ProfilerPhase(PROF_ASYNC);
 			argUpdate->f = WindowDeltaT();
 			argUpdate->next->f = now;
 			jsvmDispatchEvent(vm, "update", argUpdate);
+			ProfilerPhase(PROF_UPDATE);
 			SDL_Event evt;
 			while( SDL_PollEvent( &evt ) ) switch(evt.type) {
 			case SDL_QUIT:
 				running = false;
 				break;
 			}
+			ProfilerPhase(PROF_EVENTS);
 			if(jsvmLastError(vm)) {
 				showError("JavaScript ERROR: %s\n", jsvmLastError(vm));
 				break;
 			}
-			if(maxFps) {
-				const double deltaT = (double)SDL_GetTicks64()/1000.0 - now;
-				const double delay = 1000.0/maxFps - 1000.0*deltaT;
-				if(delay>1.0)
-					SDL_Delay(delay);
-			}
+			profilerCounters(vm, WindowPaceFrame());
+			ProfilerFrameEnd();
+			if(benchFrameEnd())
+				break;
 		}
 	}
 
+	if(benchFrames)
+		benchReport(archiveName, benchJsonName);
+	if(debug && maxFps) {
+		uint32_t numFrames, numMissed;
+		double missMean, missMax;
+		WindowFramePacingStats(&numFrames, &numMissed, &missMean, &missMax);
+		printf("frame pacing: %u of %u frames missed their deadline, by %.3fms on average, %.3fms at most\n",
+			numMissed, numFrames, missMean*1000.0, missMax*1000.0);
+	}
+
 	// cleanup:
 	jsvmDispatchEvent(vm, "close", NULL);
 	if(debug) {
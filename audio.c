@@ -350,6 +350,8 @@ static uint32_t numTracks = 0;
 static float masterVolume;
 static AudioTrack* tracks = NULL;
 static SDL_AudioSpec audioSpec;
+/// microseconds spent in audioCallback since the last call of AudioCallbackTime()
+static SDL_atomic_t callbackMicros;
 
 typedef struct {
 	float* waveData;
@@ -371,6 +373,7 @@ static void Melody_cleanup(AudioTrack* t) {
 }
 
 static void audioCallback(void *user_data, Uint8 *raw_buffer, int bytes) {
+	const Uint64 start = SDL_GetPerformanceCounter();
 	uint32_t chunkSz = audioSpec.samples;
 	Sint16 *buffer = (Sint16*)raw_buffer;
 	AudioTrack* tracks = (AudioTrack*)user_data;
@@ -444,6 +447,7 @@ static void audioCallback(void *user_data, Uint8 *raw_buffer, int bytes) {
 		for(int j=0; j<audioSpec.channels; ++j)
 			buffer[i*audioSpec.channels+j] = v[j]>32767.0f ? 32767 : v[j] < -32768.0f ? -32768 : (Sint16)v[j];
 	}
+	SDL_AtomicAdd(&callbackMicros, (int)((SDL_GetPerformanceCounter()-start)*1000000/SDL_GetPerformanceFrequency()));
 }
 
 uint32_t AudioOpen(uint32_t freq, uint32_t nTracks) {
@@ -551,6 +555,10 @@ uint32_t AudioTracks() {
 	return numTracks;
 }
 
+double AudioCallbackTime() {
+	return SDL_AtomicSet(&callbackMicros, 0) * 0.000001;
+}
+
 uint32_t AudioSampleRate() {
 	return (uint32_t)audioSpec.freq;
 }
@@ -32,6 +32,8 @@ extern float AudioGetVolume();
 extern uint32_t AudioTracks();
 /// returns the device's sample rate
 extern uint32_t AudioSampleRate();
+/// returns the seconds spent mixing audio in the audio thread since the previous call
+extern double AudioCallbackTime();
 /// immediately plays a sound, balance 0.0 means center, -1.0 left, +1.0 right
 /** \return track number playing this sound or UINT_MAX if no track is available */
 extern uint32_t AudioSound(SoundWave waveForm, float freq, float duration, float volume, float balance);
@@ -1,6 +1,7 @@
 #include "console.h"
 #include "graphics.h"
 #include "graphicsUtils.h"
+#include "profiler.h"
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -398,3 +399,36 @@ int DialogMessageBox(const char* msg, char* prompt, Value* options) {
 	Value_delete(savedEvents, 1);
 	return ret;
 }
+
+//--- statistics overlay -------------------------------------------
+
+static int statsVisible = 0;
+
+void ConsoleStatsVisible(int visible) {
+	statsVisible = visible;
+}
+
+void ConsoleDrawStats() {
+	if(!statsVisible || !gfxStateSave()) // a full state stack leaves no room for the overlay's own state
+		return;
+	const float charW = 12, charH = 16, w = 40*charW, h = (PROF_NUM_METRICS+1)*charH;
+	const float x = WindowWidth() - w, y = 0;
+	char line[64];
+	gfxStateResetTop();
+	gfxColor(0x000000b0);
+	gfxFillRect(x, y, w, h);
+	gfxColor(0xffffffff);
+	snprintf(line, sizeof(line), "frames %-9u %10s %10s", (unsigned)ProfilerNumFrames(), "avg", "max");
+	gfxFillText(0, x, y, line);
+	for(int i=0; i<PROF_NUM_METRICS; ++i) {
+		ProfilerStat stat;
+		ProfilerStats(i, &stat);
+		const char* unit = ProfilerUnit(i);
+		if(*unit)
+			snprintf(line, sizeof(line), "%-16s %7.2f%-3s %7.2f%-3s", ProfilerName(i), stat.avg, unit, stat.max, unit);
+		else
+			snprintf(line, sizeof(line), "%-16s %10.0f %10.0f", ProfilerName(i), stat.avg, stat.max);
+		gfxFillText(0, x, y + (i+1)*charH, line);
+	}
+	gfxStateRestore();
+}
@@ -11,6 +11,10 @@ extern void ConsoleLog(const char* msg);
 extern void ConsoleWarn(const char* msg);
 extern void ConsoleError(const char* msg);
 extern void ConsoleDraw();
+/// shows or hides the profiler statistics overlay
+extern void ConsoleStatsVisible(int visible);
+/// draws the profiler statistics overlay in the upper right corner, if visible
+extern void ConsoleDrawStats();
 
 #include "value.h"
 extern int DialogMessageBox(const char* msg, char* prompt, Value* options);
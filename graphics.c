@@ -1,5 +1,7 @@
 #include "graphics.h"
 #include "graphicsUtils.h"
+#include "transf2d.h"
+#include "raster.h"
 #include "font12x16.h"
 #include "external/stb_truetype.h"
 
@@ -12,28 +14,317 @@
 
 static SDL_Renderer* renderer = NULL;
 static uint32_t defaultFont;
-static float mat[] = { 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f };
 
 typedef struct {
-	float transf[4];
+	/// 2x3 affine transformation matrix, row-major
+	float mat[6];
+	/// accumulated rotation angle and scale factor, only exact as long as isUniform holds
+	float rot, sc;
+	/// true if mat consists of translation, rotation and uniform scale only
+	bool isUniform;
 	float lineWidth;
 	SDL_Color clr;
 	int blendMode;
 } GfxState;
 
-static uint8_t dtransf = 0, dtransfMax = 7;
-static GfxState gs[8];
+static GfxState* gs = NULL;
+static uint32_t dtransf = 0, numStatesMax = 0, stateStackDepth = 64;
+/// current transformation matrix, points into the top of the state stack
+static float* mat = NULL;
 
 typedef struct {
 	SDL_Texture *tex;
 	SDL_Rect src;
 	bool ownsTexture;
 	float cx, cy, sc;
+	/// dimensions of the underlying texture, needed for texture coordinates of batched draws
+	int texW, texH;
+	/// texture region tile coordinates and texture coordinates refer to, the whole texture unless atlas packed
+	SDL_Rect area;
+	/// last color/alpha modulation and blend mode applied to the texture, only maintained by its owner
+	SDL_Color texMod;
+	int texBlendMode;
+	/// set for render target layers, dirty while their content needs to be redrawn
+	bool isLayer, dirty;
+	/// incremented whenever the slot is released, invalidating outstanding handles to it
+	uint32_t gen;
 } ImgResource;
 
+/// image and font handles combine a slot index with the generation of the slot
+/** Slots used for the first time have generation 0, so their handle equals their index. Slots whose
+ * generation is exhausted are retired instead of recycled, so stale handles never become valid again. */
+#define HANDLE_INDEX_BITS 24
+#define HANDLE_INDEX_MASK ((1u<<HANDLE_INDEX_BITS)-1)
+#define HANDLE_GEN_MASK 0xffu
+
 static ImgResource* images=NULL;
+/// numImages is the number of slots ever used, released slots are recycled via freeImages
 static uint32_t numImages=0, numImagesMax=0;
+static uint32_t* freeImages=NULL;
+static uint32_t numFreeImages=0, numFreeImagesMax=0;
 static uint32_t numFonts=0, numFontsMax=0;
+static uint32_t* freeFonts=NULL;
+static uint32_t numFreeFonts=0, numFreeFontsMax=0;
+
+/// returns the slot index an image handle refers to, or UINT32_MAX if the handle is invalid or stale
+static inline uint32_t imgSlot(uint32_t img) {
+	const uint32_t idx = img & HANDLE_INDEX_MASK;
+	return (idx < numImages && images[idx].gen == img>>HANDLE_INDEX_BITS) ? idx : UINT32_MAX;
+}
+
+static inline uint32_t imgHandle(uint32_t idx) {
+	return idx | (images[idx].gen & HANDLE_GEN_MASK)<<HANDLE_INDEX_BITS;
+}
+
+/// a recorded draw call, referring to a range of the command buffer's vertices and indices
+typedef struct {
+	SDL_Texture* tex;
+	int blendMode;
+	uint32_t firstVertex, numVertices;
+	uint32_t firstIndex, numIndices;
+	/// screen space bounding box x0,y0,x1,y1
+	float bbox[4];
+	/// next command of the same merged batch, or UINT32_MAX
+	uint32_t next;
+} DrawCmd;
+
+/// per-frame buffer of draw commands, only used if deferred rendering is enabled
+typedef struct {
+	bool enabled;
+	DrawCmd* cmds;
+	uint32_t numCmds, numCmdsMax;
+	float *xy, *uv;
+	SDL_Color* clr;
+	uint32_t numVertices, numVerticesMax;
+	int* indices;
+	uint32_t numIndices, numIndicesMax;
+	/// draw calls recorded and actually submitted during the last completed frame
+	uint32_t numRecorded, numSubmitted;
+	/// accumulators of the current frame
+	uint32_t frameRecorded, frameSubmitted;
+	/// screen clear preceding the recorded commands, only deferred this way by pipelined rendering
+	bool clear;
+	SDL_Color clearColor;
+	/// memory for merging batches on submission
+	void* scratch;
+	size_t scratchSize;
+} DrawCmdBuffer;
+
+static DrawCmdBuffer dcb;
+
+/// last draw color and blend mode applied to the renderer
+typedef struct {
+	bool valid;
+	SDL_Color clr;
+	int blendMode;
+	/// SDL state changes issued and skipped during the last completed frame
+	uint32_t numIssued, numSkipped;
+	/// accumulators of the current frame
+	uint32_t frameIssued, frameSkipped;
+	/// texture of the most recent draw call
+	SDL_Texture* drawTex;
+	/// draw calls, texture switches between them, and vertices submitted during the last completed frame
+	uint32_t numDrawCalls, numTexSwitches, numVertices;
+	/// accumulators of the current frame
+	uint32_t frameDrawCalls, frameTexSwitches, frameVertices;
+} RenderState;
+
+static RenderState rs;
+
+/// render thread replaying the commands of the previous frame, only used by pipelined rendering
+typedef struct {
+	SDL_Thread* thread;
+	SDL_mutex* mutex;
+	SDL_cond* cond;
+	/// commands handed over by the main thread
+	DrawCmdBuffer replay;
+	/// busy from hand-over until the replayed frame is rasterized
+	bool busy, quit;
+	/// set from hand-over until the replayed frame is presented
+	bool unpresented;
+	/// counters of pipelined submissions, collected by the main thread while the render thread is idle
+	uint32_t numRecorded, numSubmitted, numDrawCalls, numTexSwitches, numVertices;
+	/// mid-frame operations that had to wait for the busy render thread, during the current and the last frame
+	uint32_t frameStalls, numStalls;
+	SDL_Texture* drawTex;
+} RenderPipeline;
+
+static RenderPipeline pipeline;
+
+static void quadBatchRelease();
+static void drawCmdsRelease(DrawCmdBuffer* cb);
+static void pipelineStop();
+static void drawCmdsFlush();
+static void pipelineSync();
+static void pipelineWait();
+static void pipelineHandOver();
+static void arenaReset();
+static void arenaRelease();
+static void textCacheInvalidate(uint32_t font);
+static void textCacheRelease();
+static void* arenaAlloc(size_t numBytes);
+static void glyphPagesRelease();
+static void fontsRelease();
+static void imagesRelease();
+static void meshesRelease();
+static void layerTargetsRelease();
+static void stateRelease();
+static void renderDrawColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a);
+static void renderDrawBlendMode(int mode);
+static void textureState(SDL_Texture* tex, SDL_Color mod, int blendMode);
+
+//--- render backend -----------------------------------------------
+/** All texture and renderer access goes through these functions. If the CPU rasterizer is
+ * active, SDL_Texture pointers actually refer to RasterTextures and rendering is routed to it.
+ * Functions modifying textures or rasterizer state wait for a pipelined render thread to become idle. */
+
+static int rasterThreads = 0;
+
+static SDL_Texture* textureCreate(uint32_t format, int access, int w, int h) {
+	if(rasterIsActive())
+		return (SDL_Texture*)rasterTextureCreate(w, h);
+	return SDL_CreateTexture(renderer, format, access, w, h);
+}
+
+static SDL_Texture* textureFromSurface(SDL_Surface* surf) {
+	if(!rasterIsActive())
+		return SDL_CreateTextureFromSurface(renderer, surf);
+	pipelineSync();
+	SDL_Surface* rgba = SDL_ConvertSurfaceFormat(surf, SDL_PIXELFORMAT_RGBA32, 0);
+	if(!rgba)
+		return NULL;
+	RasterTexture* tex = rasterTextureCreate(rgba->w, rgba->h);
+	if(tex)
+		rasterTextureUpdate(tex, NULL, rgba->pixels, rgba->pitch);
+	SDL_FreeSurface(rgba);
+	return (SDL_Texture*)tex;
+}
+
+static void textureDestroy(SDL_Texture* tex) {
+	pipelineSync();
+	if(rasterIsActive())
+		rasterTextureDestroy((RasterTexture*)tex);
+	else
+		SDL_DestroyTexture(tex);
+}
+
+static int textureUpdate(SDL_Texture* tex, const SDL_Rect* rect, const void* pixels, int pitch) {
+	pipelineSync();
+	if(rasterIsActive())
+		return rasterTextureUpdate((RasterTexture*)tex, rect ? &rect->x : NULL, pixels, pitch);
+	return SDL_UpdateTexture(tex, rect, pixels, pitch);
+}
+
+static int textureSize(SDL_Texture* tex, int* w, int* h) {
+	if(!rasterIsActive())
+		return SDL_QueryTexture(tex, NULL, NULL, w, h);
+	rasterTextureSize((RasterTexture*)tex, w, h);
+	return 0;
+}
+
+static void textureBlendMode(SDL_Texture* tex, int blendMode) {
+	if(rasterIsActive())
+		rasterTextureBlendMode((RasterTexture*)tex, blendMode);
+	else
+		SDL_SetTextureBlendMode(tex, blendMode);
+}
+
+/// sets texture color modulation, which the rasterizer does not need as it draws quads with vertex colors
+static void textureColorMod(SDL_Texture* tex, uint8_t r, uint8_t g, uint8_t b) {
+	if(!rasterIsActive())
+		SDL_SetTextureColorMod(tex, r, g, b);
+}
+
+static void textureAlphaMod(SDL_Texture* tex, uint8_t a) {
+	if(!rasterIsActive())
+		SDL_SetTextureAlphaMod(tex, a);
+}
+
+static void textureUserData(SDL_Texture* tex, void* userData) {
+	if(rasterIsActive())
+		rasterTextureUserData((RasterTexture*)tex, userData);
+	else
+		SDL_SetTextureUserData(tex, userData);
+}
+
+static void* textureGetUserData(SDL_Texture* tex) {
+	if(rasterIsActive())
+		return rasterTextureGetUserData((RasterTexture*)tex);
+	return SDL_GetTextureUserData(tex);
+}
+
+static int renderTarget(SDL_Texture* tex) {
+	if(!rasterIsActive())
+		return SDL_SetRenderTarget(renderer, tex);
+	pipelineSync();
+	rasterTarget((RasterTexture*)tex);
+	return 0;
+}
+
+static SDL_Texture* renderGetTarget() {
+	if(rasterIsActive())
+		return (SDL_Texture*)rasterGetTarget();
+	return SDL_GetRenderTarget(renderer);
+}
+
+/// clears the render target using the current draw color
+static void renderClear() {
+	pipelineSync();
+	if(rasterIsActive())
+		rasterClear(rs.clr.r, rs.clr.g, rs.clr.b, rs.clr.a);
+	else
+		SDL_RenderClear(renderer);
+}
+
+static void renderClipRect(const SDL_Rect* clip) {
+	pipelineSync();
+	if(rasterIsActive())
+		rasterClipRect(clip ? &clip->x : NULL);
+	else
+		SDL_RenderSetClipRect(renderer, clip);
+}
+
+/// returns the render target's dimensions and, if enabled, its clip rectangle
+static bool renderGetClipRect(int* w, int* h, SDL_Rect* clip) {
+	if(rasterIsActive()) {
+		rasterTargetSize(w, h);
+		return rasterGetClipRect(&clip->x);
+	}
+	SDL_Rect vp;
+	SDL_RenderGetViewport(renderer, &vp);
+	*w = vp.w;
+	*h = vp.h;
+	if(!SDL_RenderIsClipEnabled(renderer))
+		return false;
+	SDL_RenderGetClipRect(renderer, clip);
+	return true;
+}
+
+/// counts a draw call submitted to the renderer
+static void renderCount(SDL_Texture* tex, uint32_t numVertices) {
+	++rs.frameDrawCalls;
+	rs.frameVertices += numVertices;
+	if(tex != rs.drawTex) {
+		++rs.frameTexSwitches;
+		rs.drawTex = tex;
+	}
+}
+
+static void renderGeometryRaw(SDL_Texture* tex, const float* xy, const SDL_Color* clr, int clrStride,
+	const float* uv, int numVertices, const void* indices, int numIndices, int indexSize)
+{
+	renderCount(tex, numVertices);
+	if(rasterIsActive())
+		rasterGeometry((RasterTexture*)tex, xy, (const uint8_t*)clr, clrStride, uv, numVertices,
+			indices, numIndices, indexSize, rs.blendMode);
+	else
+		SDL_RenderGeometryRaw(renderer, tex, xy, 2*sizeof(float), clr, clrStride,
+			uv, 2*sizeof(float), numVertices, indices, numIndices, indexSize);
+}
+
+void gfxSoftwareRasterizer(int numThreads) {
+	rasterThreads = numThreads;
+}
 
 void gfxInit(uint16_t vpWidth, uint16_t vpHeight, float resScale, void *arg) {
 	(void)vpWidth;
@@ -41,7 +332,10 @@ void gfxInit(uint16_t vpWidth, uint16_t vpHeight, float resScale, void *arg) {
 
 	gfxStateReset();
 	renderer = (SDL_Renderer*)arg;
-	SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+	if(rasterThreads && !rasterInit(renderer, rasterThreads))
+		fprintf(stderr, "gfxInit WARNING: CPU rasterizer unavailable, rendering via SDL\n");
+	rs.valid = false;
+	renderDrawColor(255, 255, 255, 255);
 	SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1");
 	defaultFont = gfxSVGUpload(font12x16, sizeof(font12x16), resScale);
 	images[defaultFont].sc = 1.0f/resScale;
@@ -56,10 +350,18 @@ void gfxInit(uint16_t vpWidth, uint16_t vpHeight, float resScale, void *arg) {
 void gfxClose() {
 	if(!renderer)
 		return;
-	while(numFonts)
-		gfxFontRelease(numFonts); 
-	while(numImages)
-		gfxImageRelease(numImages-1); 
+	fontsRelease();
+	imagesRelease();
+	meshesRelease();
+	glyphPagesRelease();
+	layerTargetsRelease();
+	quadBatchRelease();
+	pipelineStop();
+	drawCmdsRelease(&dcb);
+	textCacheRelease();
+	arenaRelease();
+	stateRelease();
+	rasterClose();
 	renderer = NULL;
 }
 
@@ -73,21 +375,71 @@ void gfxTextureFiltering(int level) {
 }
 
 void gfxBeginFrame(uint32_t clearColor) {
-	SDL_SetRenderDrawColor(renderer, clearColor >> 24, clearColor >> 16, clearColor >> 8, SDL_ALPHA_OPAQUE);
-	SDL_RenderClear(renderer);
+	drawCmdsFlush();
+	arenaReset();
+	dcb.frameRecorded = dcb.frameSubmitted = 0;
+	rs.frameIssued = rs.frameSkipped = 0;
+	rs.frameDrawCalls = rs.frameTexSwitches = rs.frameVertices = 0;
+	rs.drawTex = NULL;
 	gfxStateReset();
+	rs.valid = false; // the window may have touched the renderer in between frames
+	renderDrawColor(clearColor >> 24, clearColor >> 16, clearColor >> 8, SDL_ALPHA_OPAQUE);
+	if(pipeline.thread) { // the render thread may still be drawing the previous frame
+		dcb.clear = true;
+		dcb.clearColor = rs.clr;
+	}
+	else
+		renderClear();
 	//if(resScale!=1.0f) gfxTransform(0,0,0,resScale);
 }
 
+void gfxFinishFrame() {
+	if(pipeline.thread) { // the current frame is handed over on presenting the previous one
+		pipelineWait();
+		dcb.frameRecorded += pipeline.numRecorded;
+		dcb.frameSubmitted += pipeline.numSubmitted;
+		rs.frameDrawCalls += pipeline.numDrawCalls;
+		rs.frameTexSwitches += pipeline.numTexSwitches;
+		rs.frameVertices += pipeline.numVertices;
+		pipeline.numRecorded = pipeline.numSubmitted = 0;
+		pipeline.numDrawCalls = pipeline.numTexSwitches = pipeline.numVertices = 0;
+		pipeline.numStalls = pipeline.frameStalls;
+		pipeline.frameStalls = 0;
+	}
+	else
+		drawCmdsFlush();
+	dcb.numRecorded = dcb.frameRecorded;
+	dcb.numSubmitted = dcb.frameSubmitted;
+	rs.numIssued = rs.frameIssued;
+	rs.numSkipped = rs.frameSkipped;
+	rs.numDrawCalls = rs.frameDrawCalls;
+	rs.numTexSwitches = rs.frameTexSwitches;
+	rs.numVertices = rs.frameVertices;
+}
+
+void gfxPresent() {
+	if(pipeline.thread) {
+		pipelineWait();
+		rasterPresentFrame();
+		pipeline.unpresented = false;
+		pipelineHandOver();
+	}
+	else if(rasterIsActive())
+		rasterPresent();
+	else
+		SDL_RenderPresent(renderer);
+}
+
 void gfxEndFrame() {
-	SDL_RenderPresent(renderer);
+	gfxFinishFrame();
+	gfxPresent();
 }
 
 uint32_t gfxSVGUpload(const char* svg, size_t svgLen, float scale) {
 	if(!svg) {
 		svg = font12x16;
 		svgLen = sizeof(font12x16);
-		scale /= images[defaultFont].sc;
+		scale /= images[imgSlot(defaultFont)].sc;
 	}
 	char* svgCopy = malloc(svgLen+1);
 	memcpy(svgCopy, svg, svgLen);
@@ -101,13 +453,14 @@ uint32_t gfxSVGUpload(const char* svg, size_t svgLen, float scale) {
 		return 0;
 	}
 	uint32_t img = gfxImageUpload(data, w, h, d, 0xff);
-	if(svg == font12x16)
-		images[img].sc = images[defaultFont].sc;
+	if(img && svg == font12x16)
+		images[imgSlot(img)].sc = images[imgSlot(defaultFont)].sc;
 	free(data);
 	return img;
 }
 
-uint32_t storeTexture(SDL_Texture* texture, int w, int h, bool ownsTexture) {
+/// appends a never used image slot and returns its index
+static uint32_t imgAppend() {
 	if(numImagesMax==0) {
 		numImagesMax=4;
 		images = (ImgResource*)malloc(numImagesMax*sizeof(ImgResource));
@@ -116,12 +469,73 @@ uint32_t storeTexture(SDL_Texture* texture, int w, int h, bool ownsTexture) {
 		numImagesMax *= 2;
 		images = (ImgResource*)realloc(images, numImagesMax*sizeof(ImgResource));
 	}
-	images[numImages].tex = texture;
-	images[numImages].src = (SDL_Rect){0, 0, w, h};
-	images[numImages].ownsTexture = ownsTexture;
-	images[numImages].cx = images[numImages].cy = 0.0f;
-	images[numImages].sc = 1.0f;
-	return ++numImages -1;
+	images[numImages].gen = 0;
+	return numImages++;
+}
+
+/// returns the index of a free image slot, preferably a recycled one
+static uint32_t imgAlloc() {
+	return numFreeImages ? freeImages[--numFreeImages] : imgAppend();
+}
+
+static int slotCompare(const void* a, const void* b) {
+	const uint32_t sa = *(const uint32_t*)a, sb = *(const uint32_t*)b;
+	return sa < sb ? -1 : sa > sb ? 1 : 0;
+}
+
+/// returns the first index of n consecutive free image slots sharing the same generation, preferably recycled ones
+/** Consecutive slots are needed by tile grids, as their tiles are addressed by offsets to the first handle. */
+static uint32_t imgAllocRun(uint32_t n) {
+	qsort(freeImages, numFreeImages, sizeof(uint32_t), slotCompare);
+	for(uint32_t i=0, first=0; i<numFreeImages; ++i) {
+		if(i && freeImages[i] != freeImages[i-1]+1)
+			first = i;
+		if(i+1-first < n)
+			continue;
+		const uint32_t idx = freeImages[first];
+		uint32_t gen = 0; // raising generations only invalidates further stale handles
+		for(uint32_t j=0; j<n; ++j)
+			gen = SDL_max(gen, images[idx+j].gen);
+		for(uint32_t j=0; j<n; ++j)
+			images[idx+j].gen = gen;
+		memmove(&freeImages[first], &freeImages[i+1], (numFreeImages-i-1)*sizeof(uint32_t));
+		numFreeImages -= n;
+		return idx;
+	}
+	const uint32_t idx = numImages;
+	for(uint32_t j=0; j<n; ++j)
+		imgAppend();
+	return idx;
+}
+
+static uint32_t storeTexture(SDL_Texture* texture, int w, int h, bool ownsTexture) {
+	const uint32_t idx = imgAlloc();
+	ImgResource* res = &images[idx];
+	res->tex = texture;
+	res->src = (SDL_Rect){0, 0, w, h};
+	res->ownsTexture = ownsTexture;
+	res->cx = res->cy = 0.0f;
+	res->sc = 1.0f;
+	res->texW = w;
+	res->texH = h;
+	res->area = (SDL_Rect){0, 0, w, h};
+	SDL_BlendMode blendMode = SDL_BLENDMODE_NONE;
+	SDL_Color* mod = &res->texMod;
+	*mod = (SDL_Color){ 255, 255, 255, 255 };
+	if(texture) {
+		if(rasterIsActive())
+			blendMode = rasterTextureGetBlendMode((RasterTexture*)texture);
+		else {
+			SDL_GetTextureColorMod(texture, &mod->r, &mod->g, &mod->b);
+			SDL_GetTextureAlphaMod(texture, &mod->a);
+			SDL_GetTextureBlendMode(texture, &blendMode);
+		}
+		if(ownsTexture) // lets textureState() find the shadow state by texture
+			textureUserData(texture, (void*)(uintptr_t)(idx+1));
+	}
+	res->texBlendMode = blendMode;
+	res->isLayer = res->dirty = false;
+	return imgHandle(idx);
 }
 
 uint32_t gfxImageUpload(const unsigned char* data, int w, int h, int d, uint32_t rMask) {
@@ -151,18 +565,47 @@ uint32_t gfxImageUpload(const unsigned char* data, int w, int h, int d, uint32_t
 		SDL_Log("Creating surface failed: %s", SDL_GetError());
 		return 0;
 	}
-	SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surf);
+	SDL_Texture* texture = textureFromSurface(surf);
 	SDL_FreeSurface(surf);
 	if(texture) {
 		if(d==2 || d==4)
-			SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+			textureBlendMode(texture, SDL_BLENDMODE_BLEND);
 		SDL_ClearError();
 		return storeTexture(texture, w, h, true);
 	}
 	return 0;
 }
 
+uint32_t gfxImageCreate(int w, int h) {
+	if(!renderer || w<=0 || h<=0)
+		return 0;
+	SDL_Texture* texture = textureCreate(SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, w, h);
+	if(!texture) {
+		SDL_Log("Creating texture failed: %s", SDL_GetError());
+		return 0;
+	}
+	uint8_t* pixels = calloc(w*h, 4);
+	textureUpdate(texture, NULL, pixels, w*4);
+	free(pixels);
+	textureBlendMode(texture, SDL_BLENDMODE_BLEND);
+	return storeTexture(texture, w, h, true);
+}
+
+int gfxImageUpdate(uint32_t img, int x, int y, int w, int h, const unsigned char* rgba) {
+	img = imgSlot(img);
+	if(img >= numImages || !images[img].tex)
+		return -1;
+	drawCmdsFlush();
+	const SDL_Rect rect = { x, y, w, h };
+	if(textureUpdate(images[img].tex, &rect, rgba, w*4) != 0) {
+		printf( "Unable to update texture! %s\n", SDL_GetError() );
+		return -2;
+	}
+	return 0;
+}
+
 void gfxImageSetCenter(uint32_t img, float cx, float cy) {
+	img = imgSlot(img);
 	if(img < numImages) {
 		images[img].cx = cx * images[img].src.w;
 		images[img].cy = cy * images[img].src.h;
@@ -171,87 +614,134 @@ void gfxImageSetCenter(uint32_t img, float cx, float cy) {
 }
 
 void gfxImageRelease(uint32_t img) {
-	if(img < numImages) {
-		//printf("%u %i %i %lu\n", img, images[img].src.w, images[img].src.h, (size_t)images[img].tex);
-		if(images[img].ownsTexture && images[img].tex) {
-			SDL_DestroyTexture(images[img].tex);
-			images[img].ownsTexture = false;
-		}
-		images[img].tex = NULL;
-		images[img].src.x = images[img].src.y = images[img].src.w = images[img].src.h = 0;
+	img = imgSlot(img);
+	if(img >= numImages || !images[img].tex)
+		return;
+	//printf("%u %i %i %lu\n", img, images[img].src.w, images[img].src.h, (size_t)images[img].tex);
+	if(images[img].ownsTexture) {
+		drawCmdsFlush(); // recorded commands may still refer to the texture
+		textureDestroy(images[img].tex);
+		images[img].ownsTexture = false;
+	}
+	images[img].tex = NULL;
+	images[img].src.x = images[img].src.y = images[img].src.w = images[img].src.h = 0;
+	images[img].isLayer = images[img].dirty = false;
+	if(++images[img].gen > HANDLE_GEN_MASK) // retired
+		return;
+	if(numFreeImages == numFreeImagesMax) {
+		numFreeImagesMax = numFreeImagesMax ? numFreeImagesMax*2 : 16;
+		freeImages = (uint32_t*)realloc(freeImages, numFreeImagesMax*sizeof(uint32_t));
 	}
-	while(numImages>0 && !images[numImages-1].tex)
-		--numImages;
+	freeImages[numFreeImages++] = img;
+}
+
+/// releases all images and forgets their slots
+static void imagesRelease() {
+	for(uint32_t i=0; i<numImages; ++i)
+		gfxImageRelease(imgHandle(i));
+	free(images);
+	images = NULL;
+	numImages = numImagesMax = 0;
+	free(freeImages);
+	freeImages = NULL;
+	numFreeImages = numFreeImagesMax = 0;
 }
 
 size_t gfxCanvasCreate(int w, int h, uint32_t color) {
-	SDL_Texture * texture = SDL_CreateTexture(renderer,
-		SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, w, h);
-	SDL_SetRenderTarget(renderer, texture);
-	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
-	SDL_SetRenderDrawColor(renderer, color >> 24, color >> 16, color >> 8, color & 0xff);
-	SDL_RenderClear(renderer);
+	SDL_Texture * texture = textureCreate(SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, w, h);
+	drawCmdsFlush();
+	renderTarget(texture);
+	textureBlendMode(texture, SDL_BLENDMODE_BLEND);
+	renderDrawColor(color >> 24, color >> 16, color >> 8, color & 0xff);
+	renderClear();
 	return (size_t)texture;
 }
 
 uint32_t gfxCanvasUpload(size_t canvas) {
-	SDL_SetRenderTarget(renderer, NULL);
+	drawCmdsFlush();
+	renderTarget(NULL);
 	SDL_Texture* texture = (SDL_Texture *)canvas;
 	int w,h;
-	SDL_QueryTexture(texture, NULL, NULL, &w, &h);
+	textureSize(texture, &w, &h);
 	return storeTexture(texture, w,h, SDL_TRUE);
 }
 
 uint32_t gfxVideoCanvasCreate(int w, int h) {
-	SDL_Texture * texture = SDL_CreateTexture(renderer,
-		SDL_PIXELFORMAT_IYUV, SDL_TEXTUREACCESS_STREAMING, w, h);
+	SDL_Texture * texture = textureCreate(SDL_PIXELFORMAT_IYUV, SDL_TEXTUREACCESS_STREAMING, w, h);
 	return storeTexture(texture, w,h, SDL_TRUE);
 }
 
 int gfxVideoCanvasUpdate(uint32_t img,
 	const uint8_t* yData, int yPitch, const uint8_t* uData, int uPitch, const uint8_t* vData, int vPitch) {
-	if(img >= numImages)
+	img = imgSlot(img);
+	if(img >= numImages || !images[img].tex)
 		return -1;
 	SDL_Texture * texture = images[img].tex;
-	if(SDL_UpdateYUVTexture(texture, NULL, yData, yPitch, uData, uPitch, vData, vPitch) !=0) {
+	drawCmdsFlush(); // draws recorded earlier in the frame must still show the previous video frame
+	pipelineSync();
+	const int ret = rasterIsActive()
+		? rasterTextureUpdateYUV((RasterTexture*)texture, yData, yPitch, uData, uPitch, vData, vPitch)
+		: SDL_UpdateYUVTexture(texture, NULL, yData, yPitch, uData, uPitch, vData, vPitch);
+	if(ret !=0) {
 		printf( "Unable to update texture! %s\n", SDL_GetError() );
 		return -2;
 	}
 	return 0;
 }
 
+/// initializes image slot idx as a tile of image slot parent
+static void imageTileInit(uint32_t idx, uint32_t parent, int x, int y, int w, int h) {
+	ImgResource* res = &images[idx];
+	const ImgResource* par = &images[parent];
+	res->tex = par->tex;
+	res->src = (SDL_Rect){par->area.x + x, par->area.y + y, w, h};
+	res->ownsTexture = false;
+	const float parentW = par->src.w, parentH = par->src.h;
+	res->cx = par->cx * w/parentW;
+	res->cy = par->cy * h/parentH;
+	res->sc = par->sc;
+	res->texW = par->texW;
+	res->texH = par->texH;
+	res->area = par->area;
+	res->texMod = par->texMod;
+	res->texBlendMode = par->texBlendMode;
+	res->isLayer = res->dirty = false;
+}
+
 uint32_t gfxImageTile(uint32_t parent, int x, int y, int w, int h) {
-	if(parent >= numImages)
+	parent = imgSlot(parent);
+	if(parent >= numImages || !images[parent].tex)
 		return 0;
-	if(numImages == numImagesMax) {
-		numImagesMax *= 2;
-		images = (ImgResource*)realloc(images, numImagesMax*sizeof(ImgResource));
-	}
+	const uint32_t idx = imgAlloc(); // may move images
+	imageTileInit(idx, parent, x, y, w, h);
+	return imgHandle(idx);
+}
 
-	images[numImages].tex = images[parent].tex;
-	images[numImages].src = (SDL_Rect){x, y, w, h};
-	images[numImages].ownsTexture = false;
-	const float parentW = images[parent].src.w, parentH = images[parent].src.h;
-	images[numImages].cx = images[parent].cx * w/parentW;
-	images[numImages].cy = images[parent].cy * h/parentH;
-	images[numImages].sc = images[parent].sc;
-	return ++numImages - 1;
+uint32_t gfxImageAtlasTile(uint32_t page, int x, int y, int w, int h) {
+	const uint32_t img = gfxImageTile(page, x, y, w, h);
+	const uint32_t idx = imgSlot(img);
+	if(idx < numImages)
+		images[idx].area = images[idx].src;
+	return img;
 }
 
 uint32_t gfxImageTileGrid(uint32_t parent, uint16_t tilesX, uint16_t tilesY, uint16_t border) {
-	if(parent >= numImages)
+	parent = imgSlot(parent);
+	if(parent >= numImages || !images[parent].tex || !tilesX || !tilesY)
 		return 0;
 	float w = images[parent].src.w/(float)tilesX;
 	float h = images[parent].src.h/(float)tilesY;
-	uint32_t ret = numImages;
+	// tiles are addressed as offsets to the first one, so they need consecutive slots:
+	const uint32_t ret = imgAllocRun(tilesX*tilesY); // may move images
 
 	for(uint16_t j=0; j<tilesY; ++j) for(uint16_t i=0; i<tilesX; ++i) {
-		gfxImageTile(parent, i*w+border, j*h+border, w-2*border, h-2*border);
+		imageTileInit(ret + j*tilesX + i, parent, i*w+border, j*h+border, w-2*border, h-2*border);
 	}
-	return ret;
+	return imgHandle(ret);
 }
 
 void gfxImageDimensions(uint32_t img, int* w, int* h) {
+	img = imgSlot(img);
 	if(!img || img >= numImages)
 		return;
 	if(w)
@@ -260,21 +750,184 @@ void gfxImageDimensions(uint32_t img, int* w, int* h) {
 		*h = images[img].src.h;
 }
 
+//--- render layers ------------------------------------------------
+
+/// render target and state stack depth to return to at the end of a layer
+typedef struct {
+	SDL_Texture* target;
+	uint32_t depth;
+	uint32_t img;
+} LayerTarget;
+
+static LayerTarget* layerTargets = NULL;
+static uint32_t numLayerTargets = 0, numLayerTargetsMax = 0;
+
+uint32_t gfxLayerCreate(int w, int h) {
+	if(!renderer || w<=0 || h<=0)
+		return 0;
+	SDL_Texture* texture = textureCreate(SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, w, h);
+	if(!texture) {
+		SDL_Log("Creating layer texture failed: %s", SDL_GetError());
+		return 0;
+	}
+	textureBlendMode(texture, SDL_BLENDMODE_BLEND);
+	uint32_t img = storeTexture(texture, w, h, true);
+	images[imgSlot(img)].isLayer = images[imgSlot(img)].dirty = true;
+	return img;
+}
+
+int gfxLayerBegin(uint32_t img, uint32_t clearColor) {
+	img = imgSlot(img);
+	if(img >= numImages || !images[img].isLayer || !images[img].tex)
+		return -1;
+	if(dtransf+1 >= stateStackDepth)
+		return -2;
+	drawCmdsFlush();
+	SDL_Texture* target = renderGetTarget();
+	if(renderTarget(images[img].tex) != 0) {
+		SDL_Log("Binding layer failed: %s", SDL_GetError());
+		return -3;
+	}
+	if(numLayerTargets == numLayerTargetsMax) {
+		numLayerTargetsMax = numLayerTargetsMax ? numLayerTargetsMax*2 : 4;
+		layerTargets = (LayerTarget*)realloc(layerTargets, numLayerTargetsMax*sizeof(LayerTarget));
+	}
+	layerTargets[numLayerTargets++] = (LayerTarget){ target, dtransf, imgHandle(img) };
+
+	// layer content is drawn in its own untransformed coordinates:
+	gfxStateSave();
+	mat[0] = mat[4] = 1.0f;
+	mat[1] = mat[2] = mat[3] = mat[5] = 0.0f;
+	gs[dtransf].rot = 0.0f;
+	gs[dtransf].sc = 1.0f;
+	gs[dtransf].isUniform = true;
+
+	const SDL_Color* clr = &gs[dtransf].clr;
+	renderDrawColor(clearColor >> 24, clearColor >> 16, clearColor >> 8, clearColor & 0xff);
+	renderClear();
+	renderDrawColor(clr->r, clr->g, clr->b, clr->a);
+	return 0;
+}
+
+void gfxLayerEnd() {
+	if(!numLayerTargets)
+		return;
+	drawCmdsFlush();
+	const LayerTarget* lt = &layerTargets[--numLayerTargets];
+	renderTarget(lt->target);
+	while(dtransf > lt->depth)
+		gfxStateRestore();
+	const uint32_t img = imgSlot(lt->img);
+	if(img < numImages)
+		images[img].dirty = false;
+}
+
+bool gfxLayerDirty(uint32_t img) {
+	img = imgSlot(img);
+	return img < numImages && images[img].isLayer && images[img].dirty;
+}
+
+void gfxLayerInvalidate(uint32_t img) {
+	img = imgSlot(img);
+	if(img < numImages && images[img].isLayer)
+		images[img].dirty = true;
+}
+
+void gfxLayersInvalidate() {
+	for(uint32_t i=0; i<numImages; ++i)
+		if(images[i].isLayer)
+			images[i].dirty = true;
+}
+
+static void layerTargetsRelease() {
+	free(layerTargets);
+	layerTargets = NULL;
+	numLayerTargets = numLayerTargetsMax = 0;
+}
+
 //--- font handling ------------------------------------------------
 
 #define GLYPH_MIN 32
-#define GLYPH_COUNT 224
+
+/// metrics and atlas location of a TrueType glyph
+typedef struct {
+	/// 0 marks an unused hash table slot
+	uint32_t codepoint;
+	int index;
+	/// atlas page image holding the rasterized glyph, 0 if not resident
+	uint32_t img;
+	/// position and size within the atlas page, excluding padding
+	int x, y, w, h;
+	float xoff, yoff, advance;
+} Glyph;
+
+/// signed distance field of a glyph at the face's SDF reference size
+typedef struct {
+	/// glyph index + 1, 0 marks an unused hash table slot
+	int key;
+	uint8_t* dist;
+	int w, h, xoff, yoff;
+} SdfGlyph;
+
+/// TrueType font data shared by all sizes of a font
+typedef struct {
+	unsigned char* data;
+	stbtt_fontinfo info;
+	uint32_t refs;
+	/// if set, glyph coverage is derived from cached signed distance fields instead of the outlines
+	bool sdf;
+	/// distance fields by glyph index, open addressing hash table of a power of two size
+	SdfGlyph* sdfGlyphs;
+	uint32_t numSdfGlyphs, numSdfGlyphsMax;
+} FontFace;
+
+/// parameters of signed distance fields, reference pixel height, padding, and value units per pixel
+static const float sdfHeight = 64.0f, sdfPixelDistScale = 128.0f/6.0f;
+static const int sdfPadding = 6;
+static const uint8_t sdfOnEdge = 128;
 
 typedef struct {
+	/// image of fixed width image fonts, 0 for TrueType fonts
 	uint32_t texId;
-	int texW, texH, margin;
+	int margin;
 	float height, ascent, descent;
-	stbtt_bakedchar glyphData[GLYPH_COUNT];
+	/// TrueType face, NULL for image fonts
+	FontFace* face;
+	float scale;
+	/// glyphs by codepoint, open addressing hash table of a power of two size
+	Glyph* glyphs;
+	uint32_t numGlyphs, numGlyphsMax;
+	/// incremented whenever the slot is released, invalidating outstanding handles to it
+	uint32_t gen;
 } FontResource;
 
 static FontResource* fonts=NULL;
 
-static FontResource* pushNewFont() {
+/// shared texture page TrueType glyphs are rasterized into on demand
+typedef struct {
+	uint32_t img;
+	SkylinePacker packer;
+	uint32_t lastUse;
+} GlyphPage;
+
+static GlyphPage* glyphPages = NULL;
+static uint32_t numGlyphPages = 0, numGlyphPagesMax = 0;
+static const int glyphPageSize = 512;
+/// pages are recycled in least recently used order once this limit is reached
+static const uint32_t glyphPagesLimit = 8;
+/// incremented per text layout, pages used by the current layout are never evicted
+static uint32_t glyphTick = 0;
+
+/// returns the number of a cleared font slot, preferably a recycled one
+/** Font numbers are slot index+1, as font 0 denotes the built-in font. */
+static uint32_t fontAlloc() {
+	if(numFreeFonts) {
+		const uint32_t font = freeFonts[--numFreeFonts];
+		const uint32_t gen = fonts[font-1].gen;
+		memset(&fonts[font-1], 0, sizeof(FontResource));
+		fonts[font-1].gen = gen;
+		return font;
+	}
 	if(numFontsMax==0) {
 		numFontsMax=4;
 		fonts = (FontResource*)malloc(numFontsMax*sizeof(FontResource));
@@ -283,106 +936,372 @@ static FontResource* pushNewFont() {
 		numFontsMax *= 2;
 		fonts = (FontResource*)realloc(fonts, numFontsMax*sizeof(FontResource));
 	}
-	return &fonts[numFonts];
+	memset(&fonts[numFonts], 0, sizeof(FontResource));
+	return ++numFonts;
 }
 
-uint32_t gfxFontUpload(void* fontData, size_t dataSize, float fontHeight) {
-	// render glyphs into bitmap buffer:
-	const unsigned texW = fontHeight>48.0f? 1024 : 512, texH = fontHeight>64.0f ? 2048 : 1024;
-	uint8_t* bitmap = malloc(texW*texH);
-	stbtt_bakedchar glyphData[GLYPH_COUNT];
-	stbtt_BakeFontBitmap(fontData,0, fontHeight, bitmap, texW, texH, GLYPH_MIN, GLYPH_COUNT, glyphData);
-
-	// transfer data/metrics to texture and font spec:
-	uint8_t* pixels = malloc(texW*texH*4);
-	memset(pixels, 0, texW*texH*4);
-
-	for(unsigned y=0; y<texH; ++y) for(unsigned x=0; x<texW; ++x) {
-		size_t pos = y*texW+x;
-		uint8_t px = bitmap[pos];
-		if(!px)
-			continue;
-		pixels[pos*4+0] = pixels[pos*4+1] = pixels[pos*4+2] = 255;
-		pixels[pos*4+3] = px;
-	}
-	uint32_t texId = gfxImageUpload(pixels, texW, texH, 4, 0xff);
-	free(pixels);
-	free(bitmap);
+static bool fontIsValid(uint32_t font) {
+	return font && font<=numFonts && (fonts[font-1].texId || fonts[font-1].face);
+}
+
+/// returns the font number a font handle refers to, or 0 if the handle is invalid or stale
+static inline uint32_t fontSlot(uint32_t handle) {
+	const uint32_t font = handle & HANDLE_INDEX_MASK;
+	return (fontIsValid(font) && fonts[font-1].gen == handle>>HANDLE_INDEX_BITS) ? font : 0;
+}
+
+static inline uint32_t fontHandle(uint32_t font) {
+	return font | (fonts[font-1].gen & HANDLE_GEN_MASK)<<HANDLE_INDEX_BITS;
+}
 
-	FontResource* fnt = pushNewFont();
-	fnt->texId = texId;
-	fnt->texW = texW;
-	fnt->texH = texH;
+/// creates a font of a given pixel height referring to face
+static uint32_t fontCreate(FontFace* face, float fontHeight) {
+	const uint32_t font = fontAlloc();
+	FontResource* fnt = &fonts[font-1];
 	fnt->margin = -1; // only relevant for fixed width image fonts
 	fnt->height = fontHeight;
-	memcpy(fnt->glyphData, glyphData, GLYPH_COUNT*sizeof(stbtt_bakedchar));
+	fnt->face = face;
+	fnt->scale = stbtt_ScaleForPixelHeight(&face->info, fontHeight);
 	float lineGap;
-	stbtt_GetScaledFontVMetrics(fontData,0, fontHeight, &fnt->ascent, &fnt->descent, &lineGap);
+	stbtt_GetScaledFontVMetrics(face->data,0, fontHeight, &fnt->ascent, &fnt->descent, &lineGap);
+	++face->refs;
+	return fontHandle(font);
+}
 
-	return ++numFonts;
+static uint32_t fontUpload(void* fontData, size_t dataSize, float fontHeight, bool sdf) {
+	// glyphs are rasterized lazily, so the font needs its own copy of the data:
+	unsigned char* data = malloc(dataSize);
+	memcpy(data, fontData, dataSize);
+	stbtt_fontinfo info;
+	if(!stbtt_InitFont(&info, data, stbtt_GetFontOffsetForIndex(data, 0))) {
+		fprintf(stderr, "gfxFontUpload ERROR: invalid TrueType font data\n");
+		free(data);
+		return 0;
+	}
+	FontFace* face = (FontFace*)calloc(1, sizeof(FontFace));
+	face->data = data;
+	face->info = info;
+	face->sdf = sdf;
+	return fontCreate(face, fontHeight);
+}
+
+uint32_t gfxFontUpload(void* fontData, size_t dataSize, float fontHeight) {
+	return fontUpload(fontData, dataSize, fontHeight, false);
+}
+
+uint32_t gfxFontUploadSDF(void* fontData, size_t dataSize, float fontHeight) {
+	return fontUpload(fontData, dataSize, fontHeight, true);
+}
+
+uint32_t gfxFontResize(uint32_t font, float fontHeight) {
+	font = fontSlot(font);
+	if(!font || !fonts[font-1].face)
+		return 0;
+	return fontCreate(fonts[font-1].face, fontHeight);
+}
+
+static void fontFaceRelease(FontFace* face) {
+	if(--face->refs)
+		return;
+	for(uint32_t i=0; i<face->numSdfGlyphsMax; ++i)
+		free(face->sdfGlyphs[i].dist);
+	free(face->sdfGlyphs);
+	free(face->data);
+	free(face);
 }
 
 uint32_t gfxFontFromImage(uint32_t img, int margin) {
-	FontResource* fnt = pushNewFont();
-	fnt->texId = img;
-	fnt->texW = fnt->texH = 0;
-	fnt->margin = margin; // only relevant for fixed width image fonts
-	fnt->height = fnt->ascent = fnt->descent = 0;
-	memset(fnt->glyphData, 0, sizeof(stbtt_bakedchar)*GLYPH_COUNT);
-	return ++numFonts;
+	if(!img || imgSlot(img) >= numImages)
+		return 0;
+	const uint32_t font = fontAlloc();
+	fonts[font-1].texId = img;
+	fonts[font-1].margin = margin; // only relevant for fixed width image fonts
+	return fontHandle(font);
 }
 
-void gfxFontRelease(uint32_t font) {
-	if(font<1 || font>numFonts)
+static void fontRelease(uint32_t font) {
+	if(!fontIsValid(font))
 		return;
 	FontResource* fnt = &fonts[font-1];
 	//printf("fontRelease %u tex:%u %i\n", font, fnt->texId, fnt->margin);
-	if(!fnt->texId)
+	if(fnt->face)
+		fontFaceRelease(fnt->face);
+	free(fnt->glyphs);
+	const uint32_t gen = fnt->gen + 1;
+	memset(fnt, 0, sizeof(FontResource));
+	fnt->gen = gen;
+	textCacheInvalidate(font);
+	if(gen > HANDLE_GEN_MASK) // retired
 		return;
-	if(fnt->margin<0) // means uploaded font, not font from image
-		gfxImageRelease(fnt->texId);
-	fnt->texId = 0;
 
-	while(numFonts>0 && !fonts[numFonts-1].texId)
-		--numFonts;
+	if(numFreeFonts == numFreeFontsMax) {
+		numFreeFontsMax = numFreeFontsMax ? numFreeFontsMax*2 : 16;
+		freeFonts = (uint32_t*)realloc(freeFonts, numFreeFontsMax*sizeof(uint32_t));
+	}
+	freeFonts[numFreeFonts++] = font;
 }
 
-//--- state --------------------------------------------------------
+void gfxFontRelease(uint32_t font) {
+	fontRelease(fontSlot(font));
+}
+
+/// releases all fonts and forgets their slots
+static void fontsRelease() {
+	for(uint32_t i=1; i<=numFonts; ++i)
+		fontRelease(i);
+	free(fonts);
+	fonts = NULL;
+	numFonts = numFontsMax = 0;
+	free(freeFonts);
+	freeFonts = NULL;
+	numFreeFonts = numFreeFontsMax = 0;
+}
+
+/// drops all glyphs resident in a recycled atlas page
+static void glyphPageEvict(uint32_t img) {
+	for(uint32_t i=0; i<numFonts; ++i)
+		for(uint32_t j=0; j<fonts[i].numGlyphsMax; ++j)
+			if(fonts[i].glyphs[j].img == img)
+				fonts[i].glyphs[j].img = 0;
+	textCacheInvalidate(UINT32_MAX);
+}
+
+/// allocates a w*h rectangle in a glyph atlas page, creating or recycling pages as needed
+static GlyphPage* glyphPageAlloc(int w, int h, int* x, int* y) {
+	for(uint32_t i=0; i<numGlyphPages; ++i)
+		if(skylineInsert(&glyphPages[i].packer, w, h, x, y))
+			return &glyphPages[i];
+	GlyphPage* page = NULL;
+	if(numGlyphPages < glyphPagesLimit) {
+		uint32_t img = gfxImageCreate(glyphPageSize, glyphPageSize);
+		if(!img)
+			return NULL;
+		if(numGlyphPages == numGlyphPagesMax) {
+			numGlyphPagesMax = numGlyphPagesMax ? numGlyphPagesMax*2 : 2;
+			glyphPages = (GlyphPage*)realloc(glyphPages, numGlyphPagesMax*sizeof(GlyphPage));
+		}
+		page = &glyphPages[numGlyphPages++];
+		page->img = img;
+	}
+	else {
+		for(uint32_t i=0; i<numGlyphPages; ++i)
+			if(glyphPages[i].lastUse != glyphTick && (!page || glyphPages[i].lastUse < page->lastUse))
+				page = &glyphPages[i];
+		if(!page)
+			return NULL;
+		skylineRelease(&page->packer);
+		glyphPageEvict(page->img);
+	}
+	skylineInit(&page->packer, glyphPageSize, glyphPageSize);
+	return skylineInsert(&page->packer, w, h, x, y) ? page : NULL;
+}
+
+/// marks the atlas page of image img as recently used
+static void glyphPageTouch(uint32_t img) {
+	for(uint32_t i=0; i<numGlyphPages; ++i)
+		if(glyphPages[i].img == img)
+			glyphPages[i].lastUse = glyphTick;
+}
 
-static void setMat(const float* transf) {
-	mat[0] = cos(transf[2])*transf[3]; mat[1] = -sin(transf[2])*transf[3];
-	mat[2] = transf[0]; mat[3] = -mat[1]; mat[4] = mat[0]; mat[5] = transf[1];
+static void glyphPagesRelease() {
+	for(uint32_t i=0; i<numGlyphPages; ++i)
+		skylineRelease(&glyphPages[i].packer);
+	free(glyphPages);
+	glyphPages = NULL;
+	numGlyphPages = numGlyphPagesMax = 0;
 }
 
+/// returns the cached signed distance field of a glyph, computing it on first use
+static const SdfGlyph* sdfGlyph(FontFace* face, int index) {
+	if(face->numSdfGlyphs*2 >= face->numSdfGlyphsMax) { // keep the load factor below 0.5
+		const uint32_t numMax = face->numSdfGlyphsMax ? face->numSdfGlyphsMax*2 : 256;
+		SdfGlyph* glyphs = (SdfGlyph*)calloc(numMax, sizeof(SdfGlyph));
+		for(uint32_t i=0; i<face->numSdfGlyphsMax; ++i) {
+			if(!face->sdfGlyphs[i].key)
+				continue;
+			uint32_t slot = ((uint32_t)face->sdfGlyphs[i].key * 2654435761u) & (numMax-1);
+			while(glyphs[slot].key)
+				slot = (slot+1) & (numMax-1);
+			glyphs[slot] = face->sdfGlyphs[i];
+		}
+		free(face->sdfGlyphs);
+		face->sdfGlyphs = glyphs;
+		face->numSdfGlyphsMax = numMax;
+	}
+	uint32_t slot = ((uint32_t)(index+1) * 2654435761u) & (face->numSdfGlyphsMax-1);
+	while(face->sdfGlyphs[slot].key && face->sdfGlyphs[slot].key != index+1)
+		slot = (slot+1) & (face->numSdfGlyphsMax-1);
+	SdfGlyph* glyph = &face->sdfGlyphs[slot];
+	if(!glyph->key) {
+		glyph->key = index+1;
+		const float scale = stbtt_ScaleForPixelHeight(&face->info, sdfHeight);
+		uint8_t* dist = stbtt_GetGlyphSDF(&face->info, scale, index, sdfPadding, sdfOnEdge, sdfPixelDistScale,
+			&glyph->w, &glyph->h, &glyph->xoff, &glyph->yoff);
+		if(dist) { // keep it in our own allocation, so release does not depend on stbtt's allocator
+			glyph->dist = (uint8_t*)malloc(glyph->w*glyph->h);
+			memcpy(glyph->dist, dist, glyph->w*glyph->h);
+			stbtt_FreeSDF(dist, NULL);
+		}
+		++face->numSdfGlyphs;
+	}
+	return glyph;
+}
+
+/// derives glyph coverage at the font's size from the face's signed distance field
+/** Thresholds the bilinearly sampled distance at the glyph edge with an antialiasing ramp of one target pixel.
+ * SDL renderers cannot threshold per pixel while drawing, so this happens once per glyph and size instead. */
+static void sdfCoverage(const FontResource* fnt, const Glyph* glyph, uint8_t* out, int stride) {
+	const SdfGlyph* sg = sdfGlyph(fnt->face, glyph->index);
+	if(!sg->dist)
+		return;
+	// target pixels per SDF pixel:
+	const float k = fnt->scale / stbtt_ScaleForPixelHeight(&fnt->face->info, sdfHeight);
+	for(int j=0; j<glyph->h; ++j) {
+		const float sy = (glyph->yoff + j + 0.5f)/k - sg->yoff - 0.5f;
+		const int y0 = (int)floorf(sy);
+		const float fy = sy - y0;
+		for(int i=0; i<glyph->w; ++i) {
+			const float sx = (glyph->xoff + i + 0.5f)/k - sg->xoff - 0.5f;
+			const int x0 = (int)floorf(sx);
+			const float fx = sx - x0;
+			float d[4];
+			for(int n=0; n<4; ++n) {
+				const int x = x0 + (n&1), y = y0 + (n>>1);
+				d[n] = (x<0 || y<0 || x>=sg->w || y>=sg->h) ? 0.0f : sg->dist[y*sg->w + x];
+			}
+			const float dist = (d[0]*(1.0f-fx) + d[1]*fx)*(1.0f-fy) + (d[2]*(1.0f-fx) + d[3]*fx)*fy;
+			const float cov = 0.5f + (dist - sdfOnEdge)/sdfPixelDistScale*k;
+			out[j*stride + i] = cov <= 0.0f ? 0 : cov >= 1.0f ? 255 : (uint8_t)(cov*255.0f + 0.5f);
+		}
+	}
+}
+
+/// renders a glyph into an atlas page, with one pixel of transparent padding
+static void glyphRasterize(const FontResource* fnt, Glyph* glyph) {
+	const int pw = glyph->w+2, ph = glyph->h+2;
+	int px, py;
+	GlyphPage* page = glyphPageAlloc(pw, ph, &px, &py);
+	if(!page)
+		return;
+	uint8_t* alpha = (uint8_t*)arenaAlloc(pw*ph);
+	memset(alpha, 0, pw*ph);
+	if(fnt->face->sdf)
+		sdfCoverage(fnt, glyph, alpha+pw+1, pw);
+	else
+		stbtt_MakeGlyphBitmap(&fnt->face->info, alpha+pw+1, glyph->w, glyph->h, pw, fnt->scale, fnt->scale, glyph->index);
+	// SDL renderers lack single channel formats, so coverage goes to alpha of white pixels:
+	uint8_t* rgba = (uint8_t*)arenaAlloc(pw*ph*4);
+	for(int i=0; i<pw*ph; ++i) {
+		rgba[i*4] = rgba[i*4+1] = rgba[i*4+2] = 255;
+		rgba[i*4+3] = alpha[i];
+	}
+	if(gfxImageUpdate(page->img, px, py, pw, ph, rgba) != 0)
+		return;
+	glyph->img = page->img;
+	glyph->x = px+1;
+	glyph->y = py+1;
+	page->lastUse = glyphTick;
+}
+
+/// returns the glyph of a codepoint, determining its metrics and rasterizing it on first use
+static const Glyph* fontGlyph(FontResource* fnt, uint32_t codepoint) {
+	if(fnt->numGlyphs*2 >= fnt->numGlyphsMax) { // keep the load factor below 0.5
+		const uint32_t numGlyphsMax = fnt->numGlyphsMax ? fnt->numGlyphsMax*2 : 256;
+		Glyph* glyphs = (Glyph*)calloc(numGlyphsMax, sizeof(Glyph));
+		for(uint32_t i=0; i<fnt->numGlyphsMax; ++i) {
+			if(!fnt->glyphs[i].codepoint)
+				continue;
+			uint32_t slot = (fnt->glyphs[i].codepoint * 2654435761u) & (numGlyphsMax-1);
+			while(glyphs[slot].codepoint)
+				slot = (slot+1) & (numGlyphsMax-1);
+			glyphs[slot] = fnt->glyphs[i];
+		}
+		free(fnt->glyphs);
+		fnt->glyphs = glyphs;
+		fnt->numGlyphsMax = numGlyphsMax;
+	}
+	uint32_t slot = (codepoint * 2654435761u) & (fnt->numGlyphsMax-1);
+	while(fnt->glyphs[slot].codepoint && fnt->glyphs[slot].codepoint != codepoint)
+		slot = (slot+1) & (fnt->numGlyphsMax-1);
+	Glyph* glyph = &fnt->glyphs[slot];
+	if(!glyph->codepoint) {
+		glyph->codepoint = codepoint;
+		glyph->index = stbtt_FindGlyphIndex(&fnt->face->info, codepoint);
+		int advance, lsb, x0, y0, x1, y1;
+		stbtt_GetGlyphHMetrics(&fnt->face->info, glyph->index, &advance, &lsb);
+		stbtt_GetGlyphBitmapBox(&fnt->face->info, glyph->index, fnt->scale, fnt->scale, &x0, &y0, &x1, &y1);
+		glyph->advance = advance * fnt->scale;
+		glyph->xoff = x0;
+		glyph->yoff = y0;
+		glyph->w = x1-x0;
+		glyph->h = y1-y0;
+		++fnt->numGlyphs;
+	}
+	if(glyph->img) // protects the page from eviction by later glyphs of the same layout
+		glyphPageTouch(glyph->img);
+	else if(glyph->w && glyph->h)
+		glyphRasterize(fnt, glyph);
+	return glyph;
+}
+
+//--- state --------------------------------------------------------
+
 void gfxStateReset() {
+	if(!gs) {
+		numStatesMax = 8;
+		gs = (GfxState*)malloc(numStatesMax*sizeof(GfxState));
+	}
 	dtransf = 0;
-	gs[0].transf[0] = gs[0].transf[1] = gs[0].transf[2] = 0.0f;
-	gs[0].transf[3] = 1.0f;
-	gs[0].lineWidth = 1.0f;
-	gs[0].clr.r = gs[0].clr.g = gs[0].clr.b = gs[0].clr.a = 255;
-	setMat(gs[0].transf);
-	gs[0].blendMode = SDL_BLENDMODE_BLEND;
+	gfxStateResetTop();
 }
 
-void gfxStateSave() {
-	if(dtransf >= dtransfMax)
-		return;
-	const uint8_t d = dtransf;
-	memcpy(&gs[++dtransf], &gs[d], sizeof(GfxState));
+void gfxStateResetTop() {
+	mat = gs[dtransf].mat;
+	mat[0] = mat[4] = 1.0f;
+	mat[1] = mat[2] = mat[3] = mat[5] = 0.0f;
+	gs[dtransf].rot = 0.0f;
+	gs[dtransf].sc = 1.0f;
+	gs[dtransf].isUniform = true;
+	gs[dtransf].lineWidth = 1.0f;
+	gs[dtransf].clr.r = gs[dtransf].clr.g = gs[dtransf].clr.b = gs[dtransf].clr.a = 255;
+	gs[dtransf].blendMode = SDL_BLENDMODE_BLEND;
+}
+
+void gfxStateStackDepth(uint32_t depth) {
+	stateStackDepth = depth ? depth : 1;
+}
+
+bool gfxStateSave() {
+	if(dtransf+1 >= stateStackDepth)
+		return false;
+	if(dtransf+1 == numStatesMax) {
+		numStatesMax *= 2;
+		gs = (GfxState*)realloc(gs, numStatesMax*sizeof(GfxState));
+	}
+	memcpy(&gs[dtransf+1], &gs[dtransf], sizeof(GfxState));
+	mat = gs[++dtransf].mat;
+	return true;
 }
 
 void gfxStateRestore() {
 	if(dtransf < 1)
 		return;
-	if(gs[dtransf].blendMode != gs[dtransf-1].blendMode)
-		SDL_SetRenderDrawBlendMode(renderer, gs[dtransf-1].blendMode);
-	setMat(gs[--dtransf].transf);
+	mat = gs[--dtransf].mat;
+	renderDrawBlendMode(gs[dtransf].blendMode);
+	renderDrawColor(gs[dtransf].clr.r, gs[dtransf].clr.g, gs[dtransf].clr.b, gs[dtransf].clr.a);
+}
+
+static void stateRelease() {
+	free(gs);
+	gs = NULL;
+	mat = NULL;
+	dtransf = numStatesMax = 0;
 }
 
 void gfxColor(uint32_t color) {
 	SDL_Color* clr = &gs[dtransf].clr;
 	clr->r = color >> 24, clr->g = color >> 16, clr->b = color >> 8, clr->a = color & 0xff;
-	SDL_SetRenderDrawColor(renderer, clr->r, clr->g, clr->b, clr->a);
+	renderDrawColor(clr->r, clr->g, clr->b, clr->a);
 }
 
 void gfxLineWidth(float w) {
@@ -393,7 +1312,7 @@ float gfxGetLineWidth() {
 }
 
 void gfxBlend(int mode) {
-	SDL_SetRenderDrawBlendMode(renderer, mode);
+	renderDrawBlendMode(mode);
 	gs[dtransf].blendMode = mode;
 }
 int gfxGetBlend() {
@@ -402,16 +1321,41 @@ int gfxGetBlend() {
 
 void gfxClipRect(int x, int y, int w, int h) {
 	SDL_Rect pos={x,y,w,h};
-	SDL_RenderSetClipRect(renderer, (w<0||h<0) ? NULL : &pos);
+	drawCmdsFlush();
+	renderClipRect((w<0||h<0) ? NULL : &pos);
 }
 
 void gfxTransform(float x, float y, float rot, float sc) {
-	float* transf = &gs[dtransf].transf[0];
-	transf[0] += mat[0]*x + mat[1]*y;
-	transf[1] += mat[3]*x + mat[4]*y; 
-	transf[2] += rot;
-	transf[3] *= sc;
-	setMat(transf);
+	mat[2] += mat[0]*x + mat[1]*y;
+	mat[5] += mat[3]*x + mat[4]*y;
+	if(rot != 0.0f) { // trig only needs to be evaluated for actual rotations
+		const float c = cosf(rot)*sc, s = sinf(rot)*sc;
+		const float m0 = mat[0], m3 = mat[3];
+		mat[0] = m0*c + mat[1]*s; mat[1] = mat[1]*c - m0*s;
+		mat[3] = m3*c + mat[4]*s; mat[4] = mat[4]*c - m3*s;
+		gs[dtransf].rot += rot;
+	}
+	else if(sc != 1.0f) {
+		mat[0] *= sc; mat[1] *= sc;
+		mat[3] *= sc; mat[4] *= sc;
+	}
+	gs[dtransf].sc *= sc;
+}
+
+void gfxTransformMatrix(const float* m) {
+	const float m0 = mat[0], m1 = mat[1], m3 = mat[3], m4 = mat[4];
+	mat[0] = m0*m[0] + m1*m[3]; mat[1] = m0*m[1] + m1*m[4]; mat[2] += m0*m[2] + m1*m[5];
+	mat[3] = m3*m[0] + m4*m[3]; mat[4] = m3*m[1] + m4*m[4]; mat[5] += m3*m[2] + m4*m[5];
+	GfxState* state = &gs[dtransf];
+	const float det = m[0]*m[4] - m[1]*m[3];
+	if(m[0] == m[4] && m[1] == -m[3] && det > 0.0f) { // rotation and uniform scale
+		state->rot += atan2f(m[3], m[0]);
+		state->sc *= sqrtf(det);
+	}
+	else {
+		state->isUniform = false;
+		state->sc *= sqrtf(fabsf(det));
+	}
 }
 
 void gfxTransf3d(float x, float y, float z, float rotX, float rotY, float rotZ, float sc) {
@@ -432,7 +1376,7 @@ static int utf8CharLen( unsigned char utf8Char ) {
 	return 6;
 }
 
-static unsigned char utf8ToLatin1( const char *s, size_t *readIndex ) {
+static uint32_t utf8Decode( const char *s, size_t *readIndex ) {
 	int len = utf8CharLen( (unsigned char)( s[ *readIndex ] ) );
 	if ( len == 1 ) {
 		unsigned char c = (unsigned char)s[ *readIndex ];
@@ -441,34 +1385,564 @@ static unsigned char utf8ToLatin1( const char *s, size_t *readIndex ) {
 		return c;
 	}
 
-	unsigned int v = ( s[ *readIndex ] & ( 0xff >> ( len + 1 ) ) ) << ( ( len - 1 ) * 6 );
+	uint32_t v = ( s[ *readIndex ] & ( 0xff >> ( len + 1 ) ) ) << ( ( len - 1 ) * 6 );
 	(*readIndex)++;
 	for ( len-- ; len > 0 ; len-- )  {
 		v |= ( (unsigned char)( s[ *readIndex ] ) - 0x80 ) << ( ( len - 1 ) * 6 );
 		(*readIndex)++;
 	}
+	return v;
+}
+
+static unsigned char utf8ToLatin1( const char *s, size_t *readIndex ) {
+	uint32_t v = utf8Decode(s, readIndex);
 	return ( v > 0xff ) ? 0 : (unsigned char)v;
 }
 
-/// generic affine 2d array transformation using a row-wise ordered float[6] transformation matrix
-/** arrIn and arrOut must have the same size but may point to the same memory */
-static void arrayTransf2d(const float transf[], uint32_t arrSz, const float* arrIn, float* arrOut) {
-	for(uint32_t i=0; i+1<arrSz; i+=2) {
-		float x=arrIn[i], y=arrIn[i+1];
-		arrOut[i] = x*transf[0] + y*transf[1] + transf[2];
-		arrOut[i+1] = x*transf[3] + y*transf[4] + transf[5];
+//--- frame arena --------------------------------------------------
+
+/// block of the linear allocator for temporary per-frame data
+typedef struct ArenaBlock {
+	struct ArenaBlock* prev;
+	size_t size, used;
+	uint8_t data[];
+} ArenaBlock;
+
+static ArenaBlock* arena = NULL;
+static const size_t arenaBlockSizeMin = 256*1024;
+
+static ArenaBlock* arenaBlockNew(size_t size, ArenaBlock* prev) {
+	ArenaBlock* block = (ArenaBlock*)malloc(sizeof(ArenaBlock) + size);
+	block->prev = prev;
+	block->size = size;
+	block->used = 0;
+	return block;
+}
+
+/// returns 16 byte aligned memory valid until the next gfxBeginFrame
+static void* arenaAlloc(size_t numBytes) {
+	if(arena) {
+		const uintptr_t start = ((uintptr_t)(arena->data + arena->used) + 15) & ~(uintptr_t)15;
+		const size_t offset = start - (uintptr_t)arena->data;
+		if(offset + numBytes <= arena->size) {
+			arena->used = offset + numBytes;
+			return arena->data + offset;
+		}
 	}
+	size_t size = arena ? arena->size*2 : arenaBlockSizeMin;
+	while(size < numBytes + 15)
+		size *= 2;
+	arena = arenaBlockNew(size, arena); // earlier blocks stay valid until reset
+	return arenaAlloc(numBytes);
 }
 
-// coords must already be transformed and lw already scaled
-static void gfxDrawLineW(float x1, float y1, float x2, float y2, float lw) {
-	//printf("gfxDrawLineW(%.1f,%.1f, %.1f,%.1f, %.1f)\n", x1,y1, x2,y2, lw);
-	const float dx = x2-x1, dy=y2-y1, d=sqrt(dx*dx+dy*dy);
-	const float lw2 = lw/2.0f, nx = lw2*-dy/d, ny=lw2*dx/d;
-	float c[] = {x1-nx, y1-ny, x2-nx, y2-ny, x2+nx, y2+ny, x1+nx, y1+ny};
-	static const uint8_t indices[] = { 0,1,2, 2,3,0 };
-	const SDL_Color* clr = &gs[dtransf].clr;
-	SDL_RenderGeometryRaw(renderer, NULL, c, 2*sizeof(float), clr, 0, NULL, 0, 4, indices, 6, 1);
+/// frees all per-frame allocations, merging blocks so that the next frame fits into a single one
+static void arenaReset() {
+	if(!arena)
+		return;
+	if(arena->prev) {
+		size_t size = 0;
+		while(arena) {
+			ArenaBlock* prev = arena->prev;
+			size += arena->size;
+			free(arena);
+			arena = prev;
+		}
+		arena = arenaBlockNew(size, NULL);
+	}
+	arena->used = 0;
+}
+
+static void arenaRelease() {
+	while(arena) {
+		ArenaBlock* prev = arena->prev;
+		free(arena);
+		arena = prev;
+	}
+}
+
+//--- render state shadowing ---------------------------------------
+
+/// sets the renderer's draw color unless it already is the current one
+static void renderDrawColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+	if(rs.valid && rs.clr.r == r && rs.clr.g == g && rs.clr.b == b && rs.clr.a == a) {
+		++rs.frameSkipped;
+		return;
+	}
+	SDL_SetRenderDrawColor(renderer, r, g, b, a);
+	rs.clr = (SDL_Color){ r, g, b, a };
+	if(!rs.valid) { // draw blend mode is unknown as well
+		SDL_SetRenderDrawBlendMode(renderer, rs.blendMode = gs[dtransf].blendMode);
+		++rs.frameIssued;
+	}
+	rs.valid = true;
+	++rs.frameIssued;
+}
+
+/// sets the renderer's draw blend mode unless it already is the current one
+static void renderDrawBlendMode(int mode) {
+	if(rs.valid && rs.blendMode == mode) {
+		++rs.frameSkipped;
+		return;
+	}
+	SDL_SetRenderDrawBlendMode(renderer, mode);
+	rs.blendMode = mode;
+	++rs.frameIssued;
+	if(!rs.valid) // draw color is unknown as well
+		renderDrawColor(gs[dtransf].clr.r, gs[dtransf].clr.g, gs[dtransf].clr.b, gs[dtransf].clr.a);
+}
+
+/// applies color/alpha modulation and blend mode to a texture, skipping unchanged values
+/** The shadow state is kept by the image owning the texture. Textures not owned by any image
+ * are always updated. */
+static void textureState(SDL_Texture* tex, SDL_Color mod, int blendMode) {
+	const uintptr_t owner = (uintptr_t)textureGetUserData(tex);
+	ImgResource* res = (owner && owner <= numImages && images[owner-1].tex == tex) ? &images[owner-1] : NULL;
+	if(!res) {
+		textureColorMod(tex, mod.r, mod.g, mod.b);
+		textureAlphaMod(tex, mod.a);
+		textureBlendMode(tex, blendMode);
+		rs.frameIssued += 3;
+		return;
+	}
+	if(res->texMod.r != mod.r || res->texMod.g != mod.g || res->texMod.b != mod.b) {
+		textureColorMod(tex, mod.r, mod.g, mod.b);
+		++rs.frameIssued;
+	}
+	else
+		++rs.frameSkipped;
+	if(res->texMod.a != mod.a) {
+		textureAlphaMod(tex, mod.a);
+		++rs.frameIssued;
+	}
+	else
+		++rs.frameSkipped;
+	if(res->texBlendMode != blendMode) {
+		textureBlendMode(tex, blendMode);
+		res->texBlendMode = blendMode;
+		++rs.frameIssued;
+	}
+	else
+		++rs.frameSkipped;
+	res->texMod = mod;
+}
+
+void gfxStateChangeCounters(uint32_t* issued, uint32_t* skipped) {
+	if(issued)
+		*issued = rs.numIssued;
+	if(skipped)
+		*skipped = rs.numSkipped;
+}
+
+void gfxRenderCounters(uint32_t* drawCalls, uint32_t* textureSwitches, uint32_t* vertices) {
+	if(drawCalls)
+		*drawCalls = rs.numDrawCalls;
+	if(textureSwitches)
+		*textureSwitches = rs.numTexSwitches;
+	if(vertices)
+		*vertices = rs.numVertices;
+}
+
+//--- deferred rendering -------------------------------------------
+
+/// maximum number of batches a command may be moved across to join a batch of equal state
+static const uint32_t drawCmdLookBack = 16;
+
+void gfxDeferredRendering(bool enabled) {
+	if(!enabled)
+		drawCmdsFlush();
+	dcb.enabled = enabled || pipeline.thread; // pipelined rendering depends on recorded commands
+}
+
+void gfxDrawCallCounters(uint32_t* recorded, uint32_t* submitted) {
+	if(recorded)
+		*recorded = dcb.numRecorded;
+	if(submitted)
+		*submitted = dcb.numSubmitted;
+}
+
+static void drawCmdsRelease(DrawCmdBuffer* cb) {
+	free(cb->cmds);
+	free(cb->xy);
+	free(cb->uv);
+	free(cb->clr);
+	free(cb->indices);
+	free(cb->scratch);
+	memset(cb, 0, sizeof(DrawCmdBuffer));
+}
+
+static void drawCmdsReserve(uint32_t numVertices, uint32_t numIndices) {
+	if(dcb.numCmds == dcb.numCmdsMax) {
+		dcb.numCmdsMax = dcb.numCmdsMax ? dcb.numCmdsMax*2 : 256;
+		dcb.cmds = (DrawCmd*)realloc(dcb.cmds, dcb.numCmdsMax*sizeof(DrawCmd));
+	}
+	if(dcb.numVertices + numVertices > dcb.numVerticesMax) {
+		uint32_t numVerticesMax = dcb.numVerticesMax ? dcb.numVerticesMax : 1024;
+		while(numVerticesMax < dcb.numVertices + numVertices)
+			numVerticesMax *= 2;
+		dcb.xy = (float*)realloc(dcb.xy, numVerticesMax*2*sizeof(float));
+		dcb.uv = (float*)realloc(dcb.uv, numVerticesMax*2*sizeof(float));
+		dcb.clr = (SDL_Color*)realloc(dcb.clr, numVerticesMax*sizeof(SDL_Color));
+		dcb.numVerticesMax = numVerticesMax;
+	}
+	if(dcb.numIndices + numIndices > dcb.numIndicesMax) {
+		uint32_t numIndicesMax = dcb.numIndicesMax ? dcb.numIndicesMax : 1536;
+		while(numIndicesMax < dcb.numIndices + numIndices)
+			numIndicesMax *= 2;
+		dcb.indices = (int*)realloc(dcb.indices, numIndicesMax*sizeof(int));
+		dcb.numIndicesMax = numIndicesMax;
+	}
+}
+
+/// records already transformed geometry, parameters follow SDL_RenderGeometryRaw
+static void drawCmdRecord(SDL_Texture* tex, const float* xy, const SDL_Color* clr, int clrStride,
+	const float* uv, int numVertices, const void* indices, int numIndices, int indexSize)
+{
+	if(numVertices<=0)
+		return;
+	if(!indices)
+		numIndices = numVertices;
+	drawCmdsReserve(numVertices, numIndices);
+
+	DrawCmd* cmd = &dcb.cmds[dcb.numCmds++];
+	cmd->tex = tex;
+	cmd->blendMode = gs[dtransf].blendMode;
+	cmd->firstVertex = dcb.numVertices;
+	cmd->numVertices = numVertices;
+	cmd->firstIndex = dcb.numIndices;
+	cmd->numIndices = numIndices;
+	cmd->next = UINT32_MAX;
+
+	float* bbox = cmd->bbox;
+	bbox[0] = bbox[2] = xy[0];
+	bbox[1] = bbox[3] = xy[1];
+	float* xyOut = &dcb.xy[dcb.numVertices*2];
+	for(int i=0; i<numVertices*2; i+=2) {
+		const float x = xy[i], y = xy[i+1];
+		xyOut[i] = x;
+		xyOut[i+1] = y;
+		if(x<bbox[0]) bbox[0] = x; else if(x>bbox[2]) bbox[2] = x;
+		if(y<bbox[1]) bbox[1] = y; else if(y>bbox[3]) bbox[3] = y;
+	}
+	if(uv)
+		memcpy(&dcb.uv[dcb.numVertices*2], uv, numVertices*2*sizeof(float));
+	SDL_Color* clrOut = &dcb.clr[dcb.numVertices];
+	for(int i=0; i<numVertices; ++i)
+		clrOut[i] = *(const SDL_Color*)((const uint8_t*)clr + i*clrStride);
+
+	int* idxOut = &dcb.indices[dcb.numIndices];
+	for(int i=0; i<numIndices; ++i) {
+		int idx = !indices ? i : (indexSize==1) ? ((const uint8_t*)indices)[i]
+			: (indexSize==2) ? ((const uint16_t*)indices)[i] : ((const int*)indices)[i];
+		idxOut[i] = idx; // relative to the command's first vertex, rebased on submission
+	}
+	dcb.numVertices += numVertices;
+	dcb.numIndices += numIndices;
+}
+
+static bool bboxOverlap(const float* a, const float* b) {
+	return a[0] <= b[2] && b[0] <= a[2] && a[1] <= b[3] && b[1] <= a[3];
+}
+
+/// merges commands recorded in cb of equal texture and blend mode as long as painter's order
+/// is not violated and submits the resulting batches
+/** direct submission goes straight to the rasterizer, bypassing the render state shadowed by
+ * the main thread, so it is safe on the render thread of pipelined rendering. */
+static void drawCmdsSubmit(DrawCmdBuffer* cb, bool direct) {
+	if(cb->clear) {
+		rasterClear(cb->clearColor.r, cb->clearColor.g, cb->clearColor.b, cb->clearColor.a);
+		cb->clear = false;
+	}
+	if(!cb->numCmds)
+		return;
+	const size_t scratchSize = cb->numCmds*(2*sizeof(uint32_t) + sizeof(float[4]))
+		+ cb->numVertices*(4*sizeof(float) + sizeof(SDL_Color)) + cb->numIndices*sizeof(int);
+	if(scratchSize > cb->scratchSize) {
+		free(cb->scratch);
+		cb->scratchSize = scratchSize*2;
+		cb->scratch = malloc(cb->scratchSize);
+	}
+	// batch heads/tails/bounding boxes in submission order:
+	uint32_t* heads = (uint32_t*)cb->scratch, *tails = heads + cb->numCmds;
+	float (*bboxes)[4] = (float(*)[4])(tails + cb->numCmds);
+	uint32_t numBatches = 0, numVerticesMax = 0, numIndicesMax = 0;
+
+	for(uint32_t i=0; i<cb->numCmds; ++i) {
+		DrawCmd* cmd = &cb->cmds[i];
+		uint32_t target = UINT32_MAX;
+		for(uint32_t j=numBatches, depth=0; j-->0 && depth<drawCmdLookBack; ++depth) {
+			const DrawCmd* head = &cb->cmds[heads[j]];
+			if(head->tex == cmd->tex && head->blendMode == cmd->blendMode) {
+				target = j;
+				break;
+			}
+			if(bboxOverlap(bboxes[j], cmd->bbox))
+				break; // moving further would change painter's order
+		}
+		if(target == UINT32_MAX) {
+			target = numBatches++;
+			heads[target] = tails[target] = i;
+			memcpy(bboxes[target], cmd->bbox, sizeof(float[4]));
+		}
+		else {
+			cb->cmds[tails[target]].next = i;
+			tails[target] = i;
+			float* bbox = bboxes[target];
+			if(cmd->bbox[0]<bbox[0]) bbox[0] = cmd->bbox[0];
+			if(cmd->bbox[1]<bbox[1]) bbox[1] = cmd->bbox[1];
+			if(cmd->bbox[2]>bbox[2]) bbox[2] = cmd->bbox[2];
+			if(cmd->bbox[3]>bbox[3]) bbox[3] = cmd->bbox[3];
+		}
+	}
+
+	// gather and submit batches:
+	for(uint32_t j=0; j<numBatches; ++j) {
+		uint32_t numVertices = 0, numIndices = 0;
+		for(uint32_t i=heads[j]; i!=UINT32_MAX; i=cb->cmds[i].next) {
+			numVertices += cb->cmds[i].numVertices;
+			numIndices += cb->cmds[i].numIndices;
+		}
+		if(numVertices > numVerticesMax)
+			numVerticesMax = numVertices;
+		if(numIndices > numIndicesMax)
+			numIndicesMax = numIndices;
+	}
+	float* xy = (float*)(bboxes + cb->numCmds), *uv = xy + numVerticesMax*2;
+	SDL_Color* clr = (SDL_Color*)(uv + numVerticesMax*2);
+	int* indices = (int*)(clr + numVerticesMax);
+
+	for(uint32_t j=0; j<numBatches; ++j) {
+		const DrawCmd* head = &cb->cmds[heads[j]];
+		uint32_t numVertices = 0, numIndices = 0;
+		for(uint32_t i=heads[j]; i!=UINT32_MAX; i=cb->cmds[i].next) {
+			const DrawCmd* cmd = &cb->cmds[i];
+			memcpy(&xy[numVertices*2], &cb->xy[cmd->firstVertex*2], cmd->numVertices*2*sizeof(float));
+			if(head->tex)
+				memcpy(&uv[numVertices*2], &cb->uv[cmd->firstVertex*2], cmd->numVertices*2*sizeof(float));
+			memcpy(&clr[numVertices], &cb->clr[cmd->firstVertex], cmd->numVertices*sizeof(SDL_Color));
+			for(uint32_t k=0; k<cmd->numIndices; ++k)
+				indices[numIndices+k] = cb->indices[cmd->firstIndex+k] + numVertices;
+			numVertices += cmd->numVertices;
+			numIndices += cmd->numIndices;
+		}
+		if(direct) {
+			if(head->tex)
+				rasterTextureBlendMode((RasterTexture*)head->tex, head->blendMode);
+			++pipeline.numDrawCalls;
+			pipeline.numVertices += numVertices;
+			if(head->tex != pipeline.drawTex) {
+				++pipeline.numTexSwitches;
+				pipeline.drawTex = head->tex;
+			}
+			rasterGeometry((RasterTexture*)head->tex, xy, (const uint8_t*)clr, sizeof(SDL_Color),
+				uv, numVertices, indices, numIndices, sizeof(int), head->blendMode);
+			continue;
+		}
+		if(head->tex)
+			textureState(head->tex, (SDL_Color){ 255, 255, 255, 255 }, head->blendMode);
+		else
+			renderDrawBlendMode(head->blendMode);
+		renderGeometryRaw(head->tex, xy, clr, sizeof(SDL_Color),
+			head->tex ? uv : NULL, numVertices, indices, numIndices, sizeof(int));
+	}
+	if(direct) {
+		pipeline.numRecorded += cb->numCmds;
+		pipeline.numSubmitted += numBatches;
+	}
+	else {
+		renderDrawBlendMode(gs[dtransf].blendMode);
+		cb->frameRecorded += cb->numCmds;
+		cb->frameSubmitted += numBatches;
+	}
+	cb->numCmds = cb->numVertices = cb->numIndices = 0;
+}
+
+/// submits the commands recorded so far on the main thread
+static void drawCmdsFlush() {
+	if(!dcb.numCmds && !dcb.clear)
+		return;
+	pipelineSync();
+	drawCmdsSubmit(&dcb, pipeline.thread!=NULL);
+}
+
+//--- pipelined rendering ------------------------------------------
+/** The render thread replays the commands recorded during the previous frame, and rasterizes
+ * them, while the main thread already runs the scripts of the next one. Frames are thereby
+ * shown one frame later. Mid-frame flushes, e.g. due to render target or clip changes, and
+ * texture modifications wait for the render thread and are performed by the main thread. */
+
+static int pipelineRun(void* udata) {
+	(void)udata;
+	SDL_LockMutex(pipeline.mutex);
+	while(!pipeline.quit) {
+		if(!pipeline.busy) {
+			SDL_CondWait(pipeline.cond, pipeline.mutex);
+			continue;
+		}
+		SDL_UnlockMutex(pipeline.mutex);
+		drawCmdsSubmit(&pipeline.replay, true);
+		rasterFinishFrame();
+		SDL_LockMutex(pipeline.mutex);
+		pipeline.busy = false;
+		SDL_CondBroadcast(pipeline.cond);
+	}
+	SDL_UnlockMutex(pipeline.mutex);
+	return 0;
+}
+
+/// waits until the render thread has finished replaying
+static void pipelineWait() {
+	if(!pipeline.thread)
+		return;
+	SDL_LockMutex(pipeline.mutex);
+	while(pipeline.busy)
+		SDL_CondWait(pipeline.cond, pipeline.mutex);
+	SDL_UnlockMutex(pipeline.mutex);
+}
+
+/// waits for the render thread before a mid-frame operation needing the rasterizer, counting stalls
+static void pipelineSync() {
+	if(!pipeline.thread)
+		return;
+	SDL_LockMutex(pipeline.mutex);
+	if(pipeline.busy)
+		++pipeline.frameStalls;
+	while(pipeline.busy)
+		SDL_CondWait(pipeline.cond, pipeline.mutex);
+	SDL_UnlockMutex(pipeline.mutex);
+}
+
+/// hands the commands recorded during the current frame over to the idle render thread
+static void pipelineHandOver() {
+	// swap buffers, reusing those of the previously replayed frame for recording:
+	DrawCmdBuffer recorded = dcb;
+	dcb = pipeline.replay;
+	pipeline.replay = recorded;
+	dcb.enabled = recorded.enabled;
+	dcb.numRecorded = recorded.numRecorded;
+	dcb.numSubmitted = recorded.numSubmitted;
+	dcb.frameRecorded = recorded.frameRecorded;
+	dcb.frameSubmitted = recorded.frameSubmitted;
+
+	SDL_LockMutex(pipeline.mutex);
+	pipeline.busy = pipeline.unpresented = true;
+	SDL_CondBroadcast(pipeline.cond);
+	SDL_UnlockMutex(pipeline.mutex);
+}
+
+/// terminates the render thread after it finished replaying, and presents the replayed frame
+static void pipelineStop() {
+	if(!pipeline.thread)
+		return;
+	pipelineWait();
+	if(pipeline.unpresented)
+		rasterPresentFrame();
+	SDL_LockMutex(pipeline.mutex);
+	pipeline.quit = true;
+	SDL_CondBroadcast(pipeline.cond);
+	SDL_UnlockMutex(pipeline.mutex);
+	SDL_WaitThread(pipeline.thread, NULL);
+	SDL_DestroyCond(pipeline.cond);
+	SDL_DestroyMutex(pipeline.mutex);
+	drawCmdsRelease(&pipeline.replay);
+	memset(&pipeline, 0, sizeof(RenderPipeline));
+	// the render thread changed texture blend modes behind the shadow state:
+	for(uint32_t i=0; i<numImages; ++i)
+		images[i].texBlendMode = -1;
+}
+
+uint32_t gfxPipelineStalls() {
+	return pipeline.numStalls;
+}
+
+bool gfxPipelinedRendering(bool enabled) {
+	if(!enabled)
+		pipelineStop();
+	if(!enabled || pipeline.thread)
+		return true;
+	if(!rasterIsActive()) {
+		fprintf(stderr, "gfxPipelinedRendering WARNING: ignored, requires the CPU rasterizer\n");
+		return false;
+	}
+	drawCmdsFlush();
+	pipeline.mutex = SDL_CreateMutex();
+	pipeline.cond = SDL_CreateCond();
+	pipeline.thread = SDL_CreateThread(pipelineRun, "renderer", NULL);
+	if(!pipeline.thread) {
+		SDL_Log("cannot create render thread: %s", SDL_GetError());
+		SDL_DestroyCond(pipeline.cond);
+		SDL_DestroyMutex(pipeline.mutex);
+		memset(&pipeline, 0, sizeof(RenderPipeline));
+		return false;
+	}
+	dcb.enabled = true;
+	return true;
+}
+
+/// submits already transformed geometry either immediately or to the deferred command buffer
+static void renderGeometry(SDL_Texture* tex, const float* xy, const SDL_Color* clr, int clrStride,
+	const float* uv, int numVertices, const void* indices, int numIndices, int indexSize)
+{
+	if(dcb.enabled)
+		drawCmdRecord(tex, xy, clr, clrStride, uv, numVertices, indices, numIndices, indexSize);
+	else
+		renderGeometryRaw(tex, xy, clr, clrStride, uv, numVertices, indices, numIndices, indexSize);
+}
+
+/// submits a textured quad having already transformed corner coordinates xy
+static void renderTexQuad(SDL_Texture* texture, const SDL_Rect* src, const float* xy, int flip) {
+	int texW, texH;
+	if(!texture || textureSize(texture, &texW, &texH)!=0)
+		return;
+	float u0 = src->x/(float)texW, u1 = (src->x+src->w)/(float)texW;
+	float v0 = src->y/(float)texH, v1 = (src->y+src->h)/(float)texH;
+	if(flip & SDL_FLIP_HORIZONTAL) {
+		const float u = u0; u0 = u1; u1 = u;
+	}
+	if(flip & SDL_FLIP_VERTICAL) {
+		const float v = v0; v0 = v1; v1 = v;
+	}
+	const float uv[] = { u0,v0, u1,v0, u1,v1, u0,v1 };
+	static const uint8_t indices[] = { 0,1,2, 2,3,0 };
+	renderGeometry(texture, xy, &gs[dtransf].clr, 0, uv, 4, indices, 6, 1);
+}
+
+/// equivalent of SDL_RenderCopyExF that is recorded as a textured quad in deferred mode
+/** texture color modulation has to be set by the caller and is expected to correspond to the current state color */
+static void renderCopyEx(SDL_Texture* texture, const SDL_Rect* src, const SDL_FRect* dest,
+	double angle, const SDL_FPoint* ctr, SDL_RendererFlip flip)
+{
+	if(!dcb.enabled && !rasterIsActive()) {
+		renderCount(texture, 4);
+		SDL_RenderCopyExF(renderer, texture, src, dest, angle, ctr, flip);
+		return;
+	}
+	const float px = dest->x + ctr->x, py = dest->y + ctr->y;
+	const float x0 = -ctr->x, y0 = -ctr->y, x1 = x0 + dest->w, y1 = y0 + dest->h;
+	float xy[8];
+	if(angle == 0.0) {
+		xy[0] = px+x0; xy[1] = py+y0; xy[2] = px+x1; xy[3] = py+y0;
+		xy[4] = px+x1; xy[5] = py+y1; xy[6] = px+x0; xy[7] = py+y1;
+	}
+	else {
+		const float rad = angle*M_PI/180.0, c = cosf(rad), s = sinf(rad);
+		xy[0] = px + c*x0 - s*y0; xy[1] = py + s*x0 + c*y0;
+		xy[2] = px + c*x1 - s*y0; xy[3] = py + s*x1 + c*y0;
+		xy[4] = px + c*x1 - s*y1; xy[5] = py + s*x1 + c*y1;
+		xy[6] = px + c*x0 - s*y1; xy[7] = py + s*x0 + c*y1;
+	}
+	renderTexQuad(texture, src, xy, flip);
+}
+
+// coords must already be transformed and lw already scaled
+static void gfxDrawLineW(float x1, float y1, float x2, float y2, float lw) {
+	//printf("gfxDrawLineW(%.1f,%.1f, %.1f,%.1f, %.1f)\n", x1,y1, x2,y2, lw);
+	const float dx = x2-x1, dy=y2-y1, d=sqrt(dx*dx+dy*dy);
+	const float lw2 = lw/2.0f, nx = lw2*-dy/d, ny=lw2*dx/d;
+	float c[] = {x1-nx, y1-ny, x2-nx, y2-ny, x2+nx, y2+ny, x1+nx, y1+ny};
+	static const uint8_t indices[] = { 0,1,2, 2,3,0 };
+	const SDL_Color* clr = &gs[dtransf].clr;
+	renderGeometry(NULL, c, clr, 0, NULL, 4, indices, 6, 1);
 }
 
 void gfxDrawImageEx(SDL_Texture* texture,
@@ -476,83 +1950,492 @@ void gfxDrawImageEx(SDL_Texture* texture,
 	float destX, float destY, float destW, float destH,
 	float cx, float cy, float angle, int flip)
 {
-	const SDL_Color* clr = &gs[dtransf].clr;
-	SDL_SetTextureColorMod(texture, clr->r, clr->g, clr->b);
-	SDL_SetTextureAlphaMod(texture, clr->a);
-	SDL_SetTextureBlendMode(texture, gs[dtransf].blendMode);
-
 	SDL_Rect src = { srcX, srcY, srcW, srcH };
-	const float sc = gs[dtransf].transf[3];
+	if(!gs[dtransf].isUniform) { // sheared or non-uniformly scaled, not expressible by a RenderCopyEx
+		if(!dcb.enabled) // the color is passed via the vertices
+			textureState(texture, (SDL_Color){ 255, 255, 255, 255 }, gs[dtransf].blendMode);
+		const float x0 = -cx*destW/srcW, y0 = -cy*destH/srcH, x1 = x0 + destW, y1 = y0 + destH;
+		float xy[] = { x0,y0, x1,y0, x1,y1, x0,y1 };
+		if(angle != 0.0f) {
+			const float c = cosf(angle), s = sinf(angle);
+			for(int i=0; i<8; i+=2) {
+				const float x = xy[i];
+				xy[i] = c*x - s*xy[i+1];
+				xy[i+1] = s*x + c*xy[i+1];
+			}
+		}
+		for(int i=0; i<8; i+=2) {
+			xy[i] += destX;
+			xy[i+1] += destY;
+		}
+		transf2d(mat, 8, xy, xy);
+		renderTexQuad(texture, &src, xy, flip);
+		return;
+	}
+	if(!dcb.enabled) // otherwise applied per batch on submission
+		textureState(texture, gs[dtransf].clr, gs[dtransf].blendMode);
+	const float sc = gs[dtransf].sc;
 	SDL_FPoint ctr = { cx*sc*destW/srcW, cy*sc*destH/srcH };
 	SDL_FRect dest = {
 		destX*mat[0] + destY*mat[1] + mat[2] - ctr.x,
 		destX*mat[3] + destY*mat[4] + mat[5] - ctr.y,
 		destW*sc, destH*sc};
-	SDL_RenderCopyExF(renderer, texture, &src, &dest, (angle + gs[dtransf].transf[2])*180.0f/M_PI, &ctr, flip);
+	renderCopyEx(texture, &src, &dest, (angle + gs[dtransf].rot)*180.0f/M_PI, &ctr, flip);
+}
+
+//--- batched quads -----------------------------------------------
+
+/// vertex buffer collecting textured quads that share the same texture
+typedef struct {
+	float* xy;
+	float* uv;
+	SDL_Color* clr;
+	uint32_t numQuads, numQuadsMax;
+} QuadBatch;
+
+static QuadBatch batch = { NULL, NULL, NULL, 0, 0 };
+/// upper limit of quads per single geometry submission
+static const uint32_t batchQuadsMax = 8192;
+/// shared index buffer of consecutive quads, only grows
+static int* quadIndices = NULL;
+static uint32_t numQuadIndicesMax = 0;
+
+/// allocates room for numQuads quads from the frame arena
+static void quadBatchReserve(uint32_t numQuads) {
+	batch.xy = (float*)arenaAlloc(numQuads*8*sizeof(float));
+	batch.uv = (float*)arenaAlloc(numQuads*8*sizeof(float));
+	batch.clr = (SDL_Color*)arenaAlloc(numQuads*4*sizeof(SDL_Color));
+	batch.numQuads = 0;
+	batch.numQuadsMax = numQuads;
+	if(numQuads <= numQuadIndicesMax)
+		return;
+	quadIndices = (int*)realloc(quadIndices, numQuads*6*sizeof(int));
+	for(uint32_t i=numQuadIndicesMax; i<numQuads; ++i) {
+		int* idx = &quadIndices[i*6];
+		idx[0] = i*4; idx[1] = i*4+1; idx[2] = i*4+2;
+		idx[3] = i*4+2; idx[4] = i*4+3; idx[5] = i*4;
+	}
+	numQuadIndicesMax = numQuads;
+}
+
+static void quadBatchRelease() {
+	free(quadIndices);
+	quadIndices = NULL;
+	numQuadIndicesMax = 0;
+	memset(&batch, 0, sizeof(QuadBatch));
+}
+
+/// transforms collected quads by the current matrix and submits them in a single call
+static void quadBatchFlush(SDL_Texture* texture) {
+	if(!batch.numQuads)
+		return;
+	if(texture && !dcb.enabled) // vertex colors carry the modulation, so neutralize any texture color mod left by other draws:
+		textureState(texture, (SDL_Color){ 255, 255, 255, 255 }, gs[dtransf].blendMode);
+	transf2d(mat, batch.numQuads*8, batch.xy, batch.xy);
+	renderGeometry(texture, batch.xy, batch.clr, sizeof(SDL_Color),
+		batch.uv, batch.numQuads*4, quadIndices, batch.numQuads*6, sizeof(int));
+	batch.numQuads = 0;
+}
+
+/// appends an image quad in untransformed coordinates, rotated by rot around its center x|y
+static void quadBatchPush(const ImgResource* res, float x, float y, float sc, float rot, SDL_Color clr) {
+	const float w = res->src.w*res->sc*sc, h = res->src.h*res->sc*sc;
+	const float x0 = -res->cx*res->sc*sc, y0 = -res->cy*res->sc*sc, x1 = x0+w, y1 = y0+h;
+	float* xy = &batch.xy[batch.numQuads*8];
+	if(rot == 0.0f) {
+		xy[0] = x+x0; xy[1] = y+y0;
+		xy[2] = x+x1; xy[3] = y+y0;
+		xy[4] = x+x1; xy[5] = y+y1;
+		xy[6] = x+x0; xy[7] = y+y1;
+	}
+	else {
+		const float c = cosf(rot), s = sinf(rot);
+		xy[0] = x + c*x0 - s*y0; xy[1] = y + s*x0 + c*y0;
+		xy[2] = x + c*x1 - s*y0; xy[3] = y + s*x1 + c*y0;
+		xy[4] = x + c*x1 - s*y1; xy[5] = y + s*x1 + c*y1;
+		xy[6] = x + c*x0 - s*y1; xy[7] = y + s*x0 + c*y1;
+	}
+	const float u0 = res->src.x/(float)res->texW, u1 = (res->src.x+res->src.w)/(float)res->texW;
+	const float v0 = res->src.y/(float)res->texH, v1 = (res->src.y+res->src.h)/(float)res->texH;
+	float* uv = &batch.uv[batch.numQuads*8];
+	uv[0] = u0; uv[1] = v0;
+	uv[2] = u1; uv[3] = v0;
+	uv[4] = u1; uv[5] = v1;
+	uv[6] = u0; uv[7] = v1;
+	SDL_Color* vc = &batch.clr[batch.numQuads*4];
+	vc[0] = vc[1] = vc[2] = vc[3] = clr;
+	++batch.numQuads;
+}
+
+//--- polylines -----------------------------------------------------
+
+/// vertex and index buffers for tessellated line strips and loops
+typedef struct {
+	float* xy;
+	uint32_t numVertices;
+	int* indices;
+	uint32_t numIndices;
+} PolylineBuffer;
+
+static PolylineBuffer pl = { NULL, 0, NULL, 0 };
+/// joins whose miter would exceed this multiple of the half line width are beveled
+static const float miterLimit = 4.0f;
+
+/// allocates polyline buffers from the frame arena
+static void polylineReserve(uint32_t numVertices, uint32_t numIndices) {
+	pl.xy = (float*)arenaAlloc(numVertices*2*sizeof(float));
+	pl.indices = (int*)arenaAlloc(numIndices*sizeof(int));
+	pl.numVertices = pl.numIndices = 0;
+}
+
+static int polylineVertex(float x, float y) {
+	pl.xy[pl.numVertices*2] = x;
+	pl.xy[pl.numVertices*2+1] = y;
+	return pl.numVertices++;
+}
+
+static void polylineTriangle(int i0, int i1, int i2) {
+	int* idx = &pl.indices[pl.numIndices];
+	idx[0] = i0; idx[1] = i1; idx[2] = i2;
+	pl.numIndices += 3;
+}
+
+/// tessellates the first numPts coordinate pairs of the buffer into a single triangle list and submits it
+/** buffer capacity has to be reserved for numPts*6 vertices and numPts*12 indices,
+ * coordinates must already be transformed and hw is the transformed half line width */
+static void polylineDraw(uint32_t numPts, bool closed, float hw) {
+	// drop zero length segments:
+	uint32_t n = 0;
+	for(uint32_t i=0; i<numPts; ++i) {
+		const float x = pl.xy[i*2], y = pl.xy[i*2+1];
+		if(n && fabsf(x-pl.xy[n*2-2]) < 1.0e-4f && fabsf(y-pl.xy[n*2-1]) < 1.0e-4f)
+			continue;
+		pl.xy[n*2] = x;
+		pl.xy[n*2+1] = y;
+		++n;
+	}
+	if(closed && n>2 && fabsf(pl.xy[0]-pl.xy[n*2-2]) < 1.0e-4f && fabsf(pl.xy[1]-pl.xy[n*2-1]) < 1.0e-4f)
+		--n;
+	if(n<2)
+		return;
+	if(n==2)
+		closed = false;
+	const uint32_t numSegs = closed ? n : n-1;
+
+	// points stay at the buffer start, generated vertices follow (at most 5 per point):
+	pl.numVertices = n;
+	pl.numIndices = 0;
+	// vertex indices of a point's left|right ends of the incoming and outgoing segment:
+	int* ends = (int*)arenaAlloc(n*4*sizeof(int));
+
+	for(uint32_t i=0; i<n; ++i) {
+		const float px = pl.xy[i*2], py = pl.xy[i*2+1];
+		const bool hasIn = closed || i>0, hasOut = closed || i+1<n;
+		const uint32_t iPrev = (i+n-1)%n, iNext = (i+1)%n;
+		float n0x=0.0f, n0y=0.0f, n1x=0.0f, n1y=0.0f, len0=0.0f, len1=0.0f;
+		if(hasIn) {
+			const float dx = px-pl.xy[iPrev*2], dy = py-pl.xy[iPrev*2+1];
+			len0 = sqrtf(dx*dx+dy*dy);
+			n0x = -dy/len0; n0y = dx/len0;
+		}
+		if(hasOut) {
+			const float dx = pl.xy[iNext*2]-px, dy = pl.xy[iNext*2+1]-py;
+			len1 = sqrtf(dx*dx+dy*dy);
+			n1x = -dy/len1; n1y = dx/len1;
+		}
+		int* end = &ends[i*4];
+		if(!hasIn || !hasOut) { // butt cap
+			const float nx = hasIn ? n0x : n1x, ny = hasIn ? n0y : n1y;
+			end[0] = end[2] = polylineVertex(px+nx*hw, py+ny*hw);
+			end[1] = end[3] = polylineVertex(px-nx*hw, py-ny*hw);
+			continue;
+		}
+
+		float mx = n0x+n1x, my = n0y+n1y;
+		const float mLen = sqrtf(mx*mx+my*my);
+		const float cosHalf = mLen * 0.5f; // = dot(normalized miter, n0)
+		// the inner miter point must not lie beyond the neighbouring joints:
+		const bool innerMiter = mLen > 1.0e-4f && hw/cosHalf < fminf(len0, len1);
+		const bool miter = cosHalf > 1.0f/miterLimit;
+		if(miter && innerMiter) {
+			const float d = hw/cosHalf/mLen;
+			end[0] = end[2] = polylineVertex(px+mx*d, py+my*d);
+			end[1] = end[3] = polylineVertex(px-mx*d, py-my*d);
+			continue;
+		}
+
+		// bevel join or miter join with overlapping inner sides, the outer side is the one the path turns away from:
+		const float turn = n1y*n0x - n1x*n0y; // dot(outgoing direction, n0)
+		const float side = (turn > 0.0f) ? -1.0f : 1.0f;
+		const int outerIn = polylineVertex(px+side*n0x*hw, py+side*n0y*hw);
+		const int outerOut = polylineVertex(px+side*n1x*hw, py+side*n1y*hw);
+		int innerIn, innerOut, center;
+		if(innerMiter) {
+			const float d = hw/cosHalf/mLen;
+			innerIn = innerOut = center = polylineVertex(px-side*mx*d, py-side*my*d);
+		}
+		else { // inner miter point too far away, let segments overlap instead
+			innerIn = polylineVertex(px-side*n0x*hw, py-side*n0y*hw);
+			innerOut = polylineVertex(px-side*n1x*hw, py-side*n1y*hw);
+			center = i;
+		}
+		polylineTriangle(center, outerIn, outerOut);
+		if(miter) {
+			const float d = hw/cosHalf/mLen;
+			polylineTriangle(outerIn, polylineVertex(px+side*mx*d, py+side*my*d), outerOut);
+		}
+		end[0] = (side>0.0f) ? outerIn : innerIn;
+		end[1] = (side>0.0f) ? innerIn : outerIn;
+		end[2] = (side>0.0f) ? outerOut : innerOut;
+		end[3] = (side>0.0f) ? innerOut : outerOut;
+	}
+
+	for(uint32_t i=0; i<numSegs; ++i) {
+		const int* a = &ends[i*4], *b = &ends[((i+1)%n)*4];
+		polylineTriangle(a[2], b[0], b[1]);
+		polylineTriangle(b[1], a[3], a[2]);
+	}
+	renderGeometry(NULL, pl.xy, &gs[dtransf].clr, 0, NULL, pl.numVertices, pl.indices, pl.numIndices, sizeof(int));
+}
+
+/// transforms numPts coordinate pairs by the current matrix and draws them as joined lines
+static void polylineTransfDraw(uint32_t numPts, const float* coords, bool closed) {
+	polylineReserve(numPts*6, numPts*12);
+	transf2d(mat, numPts*2, coords, pl.xy);
+	polylineDraw(numPts, closed, 0.5f * gs[dtransf].lineWidth * gs[dtransf].sc);
+}
+
+//--- text layout --------------------------------------------------
+
+/// glyph quads of a string laid out in untransformed coordinates relative to the text origin
+/** the same layout serves measuring and drawing, so aligned text is only decoded once */
+typedef struct {
+	uint32_t font;
+	uint32_t hash;
+	char* str;
+	float* xy;
+	float* uv;
+	/// image handle per quad, glyphs of TrueType fonts may reside in different atlas pages
+	uint32_t* img;
+	uint32_t numQuads, numQuadsMax;
+	/// sum of glyph advances
+	float width;
+	/// tick of the last lookup, 0 marks an unused entry
+	uint32_t lastUse;
+} TextLayout;
+
+#define TEXT_CACHE_SIZE 128
+static TextLayout textCache[TEXT_CACHE_SIZE];
+static uint32_t textCacheTick = 0;
+
+/// FNV-1a hash of a zero-terminated string
+static uint32_t strHash(const char* str) {
+	uint32_t hash = 2166136261u;
+	for(; *str; ++str)
+		hash = (hash ^ (unsigned char)*str) * 16777619u;
+	return hash;
+}
+
+/// drops cached layouts of font, or all layouts if font is UINT32_MAX
+static void textCacheInvalidate(uint32_t font) {
+	for(uint32_t i=0; i<TEXT_CACHE_SIZE; ++i)
+		if(textCache[i].font == font || font == UINT32_MAX)
+			textCache[i].lastUse = 0;
+}
+
+static void textCacheRelease() {
+	for(uint32_t i=0; i<TEXT_CACHE_SIZE; ++i) {
+		free(textCache[i].str);
+		free(textCache[i].xy);
+		free(textCache[i].uv);
+		free(textCache[i].img);
+	}
+	memset(textCache, 0, sizeof(textCache));
+	textCacheTick = 0;
+}
+
+static void textLayoutPushQuad(TextLayout* tl, uint32_t img, float x0, float y0, float x1, float y1,
+	float u0, float v0, float u1, float v1)
+{
+	if(tl->numQuads == tl->numQuadsMax) {
+		tl->numQuadsMax = tl->numQuadsMax ? tl->numQuadsMax*2 : 16;
+		tl->xy = (float*)realloc(tl->xy, tl->numQuadsMax*8*sizeof(float));
+		tl->uv = (float*)realloc(tl->uv, tl->numQuadsMax*8*sizeof(float));
+		tl->img = (uint32_t*)realloc(tl->img, tl->numQuadsMax*sizeof(uint32_t));
+	}
+	tl->img[tl->numQuads] = img;
+	float* xy = &tl->xy[tl->numQuads*8], *uv = &tl->uv[tl->numQuads*8];
+	xy[0] = x0; xy[1] = y0; xy[2] = x1; xy[3] = y0;
+	xy[4] = x1; xy[5] = y1; xy[6] = x0; xy[7] = y1;
+	uv[0] = u0; uv[1] = v0; uv[2] = u1; uv[3] = v0;
+	uv[4] = u1; uv[5] = v1; uv[6] = u0; uv[7] = v1;
+	++tl->numQuads;
+}
+
+/// lays out text using a texture containing a fixed 16x16 grid of glyphs
+static void textLayoutFixedFont(TextLayout* tl, uint32_t img, int margin, const char* str) {
+	uint32_t idx = imgSlot(img);
+	if(idx>=numImages)
+		img = idx = 0;
+	const ImgResource* res = &images[idx];
+	const unsigned char wCell = res->src.w/16, wChar = wCell - margin*2;
+	const unsigned char hCell = res->src.h/16, hChar = hCell - margin*2;
+	const float w = wChar*res->sc, h = hChar*res->sc;
+	float x = 0.0f;
+	for(size_t readIndex=0; str[readIndex]; x += w) {
+		unsigned char c = utf8ToLatin1(str, &readIndex);
+		if(!c)
+			continue;
+		const int srcX = res->area.x + (c%16)*wCell + margin, srcY = res->area.y + (c/16)*hCell + margin;
+		textLayoutPushQuad(tl, img, x, 0.0f, x+w, h,
+			srcX/(float)res->texW, srcY/(float)res->texH,
+			(srcX+wChar)/(float)res->texW, (srcY+hChar)/(float)res->texH);
+	}
+	tl->width = x;
+}
+
+static void textLayoutProportionalFont(TextLayout* tl, FontResource* fnt, const char* str) {
+	++glyphTick;
+	float x = 0.0f;
+	for(size_t readIndex=0; str[readIndex]; ) {
+		uint32_t c = utf8Decode(str, &readIndex);
+		if(c<GLYPH_MIN)
+			c = ' '; // render as space
+
+		const Glyph* glyph = fontGlyph(fnt, c);
+		if(glyph->img) {
+			const float x0 = x + glyph->xoff + 0.5f, y0 = fnt->ascent + glyph->yoff + 0.5f;
+			textLayoutPushQuad(tl, glyph->img, x0, y0, x0+glyph->w, y0+glyph->h,
+				glyph->x/(float)glyphPageSize, glyph->y/(float)glyphPageSize,
+				(glyph->x+glyph->w)/(float)glyphPageSize, (glyph->y+glyph->h)/(float)glyphPageSize);
+		}
+		x += glyph->advance;
+	}
+	tl->width = x;
+}
+
+/// returns the cached layout of str, (re)building the least recently used cache entry on a miss
+static TextLayout* textLayout(uint32_t font, const char* str) {
+	if(!fontIsValid(font))
+		font = 0;
+	const uint32_t hash = strHash(str);
+	TextLayout* lru = &textCache[0];
+	for(uint32_t i=0; i<TEXT_CACHE_SIZE; ++i) {
+		TextLayout* tl = &textCache[i];
+		if(tl->lastUse && tl->font==font && tl->hash==hash && strcmp(tl->str, str)==0) {
+			tl->lastUse = ++textCacheTick;
+			return tl;
+		}
+		if(tl->lastUse < lru->lastUse)
+			lru = tl;
+	}
+
+	free(lru->str);
+	lru->str = strdup(str);
+	lru->font = font;
+	lru->hash = hash;
+	lru->numQuads = 0;
+	if(!font)
+		textLayoutFixedFont(lru, 0, 0, str);
+	else if(fonts[font-1].margin >= 0)
+		textLayoutFixedFont(lru, fonts[font-1].texId, fonts[font-1].margin, str);
+	else
+		textLayoutProportionalFont(lru, &fonts[font-1], str);
+	lru->lastUse = ++textCacheTick;
+	return lru;
 }
 
 //--- basic drawing operations -------------------------------------
 
 void gfxDrawRect(float x, float y, float w, float h) {
-	float lw = gs[dtransf].lineWidth, lw2 = lw/2.0f;
-	float c[] = {x,y+lw2, x+w,y+lw2, x+w-lw2,y+lw, x+w-lw2,y+h-lw, x+w,y+h-lw2, x,y+h-lw2, x+lw2,y+h-lw, x+lw2,y+lw };
-	arrayTransf2d(mat, countof(c), c, c);
-	lw *= gs[dtransf].transf[3];
-	gfxDrawLineW(c[0],c[1], c[2],c[3], lw);
-	gfxDrawLineW(c[4],c[5], c[6],c[7], lw);
-	gfxDrawLineW(c[8],c[9], c[10],c[11], lw);
-	gfxDrawLineW(c[12],c[13], c[14],c[15], lw);
+	const float lw2 = gs[dtransf].lineWidth/2.0f;
+	const float c[] = {x+lw2,y+lw2, x+w-lw2,y+lw2, x+w-lw2,y+h-lw2, x+lw2,y+h-lw2 };
+	polylineTransfDraw(4, c, true);
 }
 
 void gfxFillRect(float x, float y, float w, float h) {
 	float c[] = {x,y, x+w,y, x+w,y+h, x,y+h };
 	static const uint8_t indices[] = { 0,1,2, 2,3,0 };
-	arrayTransf2d(mat, countof(c), c, c);
+	transf2d(mat, countof(c), c, c);
 	const SDL_Color* clr = &gs[dtransf].clr;
-	SDL_RenderGeometryRaw(renderer, NULL, c, 2*sizeof(float), clr, 0, NULL, 0, 4, indices, 6, 1);
+	renderGeometry(NULL, c, clr, 0, NULL, 4, indices, 6, 1);
 }
 
 void gfxFillTriangle(float x0, float y0, float x1, float y1, float x2, float y2) {
 	float c[] = {x0,y0, x1,y1, x2,y2 };
-	arrayTransf2d(mat, countof(c), c, c);
+	transf2d(mat, countof(c), c, c);
 	const SDL_Color* clr = &gs[dtransf].clr;
-	SDL_RenderGeometryRaw(renderer, NULL, c, 2*sizeof(float), clr, 0, NULL, 0, 3, NULL, 0, 0);
+	renderGeometry(NULL, c, clr, 0, NULL, 3, NULL, 0, 0);
 }
 
 void gfxDrawLine(float x0, float y0, float x1, float y1) {
 	float c[] = {x0,y0, x1,y1 };
-	arrayTransf2d(mat, countof(c), c, c);
-	gfxDrawLineW(c[0],c[1], c[2],c[3], gs[dtransf].lineWidth * gs[dtransf].transf[3]);
+	transf2d(mat, countof(c), c, c);
+	gfxDrawLineW(c[0],c[1], c[2],c[3], gs[dtransf].lineWidth * gs[dtransf].sc);
 }
 
 void gfxDrawLineStrip(uint32_t numCoords, const float* coords) {
-	for(uint32_t i=2, end=numCoords*2; i<end; i+=2)
-		gfxDrawLine(coords[i-2], coords[i-1], coords[i], coords[i+1]);
+	if(numCoords>1)
+		polylineTransfDraw(numCoords, coords, false);
 }
 
 void gfxDrawLineLoop(uint32_t numCoords, const float* coords) {
-	gfxDrawLineStrip(numCoords, coords);
-	if(numCoords>2)
-		gfxDrawLine(coords[numCoords*2-2], coords[numCoords*2-1], coords[0], coords[1]);
+	if(numCoords>1)
+		polylineTransfDraw(numCoords, coords, numCoords>2);
 }
 
-void gfxDrawPoints(uint32_t numCoords, const float* coords, uint32_t img) {
+void gfxDrawPoints(uint32_t numCoords, const float* coords, uint32_t img, const uint32_t* colors, const float* sizes) {
 	float lineWidth = gs[dtransf].lineWidth;
-	const float* transf = gs[dtransf].transf;
-	if(lineWidth==1.0f && transf[0]==0.0f && transf[1]==0.0f && transf[2] == 0.0f && transf[3]==1.0f) {
-		SDL_RenderDrawPointsF(renderer, (const SDL_FPoint*)coords, numCoords);
+	if(lineWidth==1.0f && !colors && !sizes && mat[0]==1.0f && mat[1]==0.0f && mat[2]==0.0f
+		&& mat[3]==0.0f && mat[4]==1.0f && mat[5]==0.0f) {
+		drawCmdsFlush();
+		renderCount(NULL, numCoords);
+		if(rasterIsActive())
+			rasterPoints(coords, numCoords, (const uint8_t*)&rs.clr, rs.blendMode);
+		else
+			SDL_RenderDrawPointsF(renderer, (const SDL_FPoint*)coords, numCoords);
 		return;
 	}
-	if(!img || img >= numImages)
+	img = imgSlot(img);
+	if(!img || img >= numImages || !images[img].tex)
 		img = GFX_IMG_CIRCLE;
-	ImgResource* res = &images[img];
+	const ImgResource* res = &images[img];
+	if(!numCoords || !res->src.w || !res->src.h)
+		return;
+	// each point becomes a sprite quad of size x size, all sharing the same texture coordinates:
+	const float ax = res->cx/res->src.w, ay = res->cy/res->src.h;
+	const float u0 = res->src.x/(float)res->texW, u1 = (res->src.x+res->src.w)/(float)res->texW;
+	const float v0 = res->src.y/(float)res->texH, v1 = (res->src.y+res->src.h)/(float)res->texH;
+	const SDL_Color clr = gs[dtransf].clr;
+	quadBatchReserve(numCoords < batchQuadsMax ? numCoords : batchQuadsMax);
 	for(uint32_t i=0; i<numCoords; ++i) {
-		gfxDrawImageEx(res->tex, res->src.x,res->src.y,res->src.w,res->src.h,
-			coords[i*2],coords[i*2+1], lineWidth,lineWidth, res->cx,res->cy, 0,0);
+		const SDL_Color pc = colors ? *(const SDL_Color*)&colors[i] : clr;
+		const float size = sizes ? sizes[i] : lineWidth;
+		if(!pc.a || size <= 0.0f)
+			continue;
+		if(batch.numQuads == batch.numQuadsMax)
+			quadBatchFlush(res->tex);
+		const float x0 = coords[i*2] - ax*size, y0 = coords[i*2+1] - ay*size;
+		const float x1 = x0 + size, y1 = y0 + size;
+		float* xy = &batch.xy[batch.numQuads*8];
+		xy[0] = x0; xy[1] = y0;
+		xy[2] = x1; xy[3] = y0;
+		xy[4] = x1; xy[5] = y1;
+		xy[6] = x0; xy[7] = y1;
+		float* uv = &batch.uv[batch.numQuads*8];
+		uv[0] = u0; uv[1] = v0;
+		uv[2] = u1; uv[3] = v0;
+		uv[4] = u1; uv[5] = v1;
+		uv[6] = u0; uv[7] = v1;
+		SDL_Color* vc = &batch.clr[batch.numQuads*4];
+		vc[0] = vc[1] = vc[2] = vc[3] = pc;
+		++batch.numQuads;
 	}
+	quadBatchFlush(res->tex);
 }
 
 void gfxDrawImage(uint32_t img, float x, float y, float rot, float sc, int flip) {
+	img = imgSlot(img);
 	if(!img || img >= numImages)
 		return;
 	ImgResource* res = &images[img];
@@ -561,109 +2444,75 @@ void gfxDrawImage(uint32_t img, float x, float y, float rot, float sc, int flip)
 }
 
 void gfxStretchImage(uint32_t img, float x, float y, float w, float h) {
+	img = imgSlot(img);
 	if(!img || img >= numImages)
 		return;
 	ImgResource* res = &images[img];
 	gfxDrawImageEx(res->tex, res->src.x,res->src.y,res->src.w,res->src.h, x,y,w,h, 0,0,0,0);
 }
 
-/// write text using a texture containing a fixed 16x16 grid of glyphs
-static void gfxFillTextFixedFont(uint32_t img, float x, float y, int margin, const char* str) {
-	if(img>=numImages)
-		img = 0;
-	const unsigned char wCell = images[img].src.w/16, wChar = wCell - margin*2;
-	const unsigned char hCell = images[img].src.h/16, hChar = hCell - margin*2;
-	SDL_Texture* texture = images[img].tex;
-
-	const SDL_Color* clr = &gs[dtransf].clr;
-	SDL_SetTextureColorMod(texture, clr->r, clr->g, clr->b);
-	SDL_SetTextureAlphaMod(texture, clr->a);
-	SDL_SetTextureBlendMode(texture, gs[dtransf].blendMode);
-
-	SDL_Rect src  = { 0, 0, wChar, hChar };
-	float rot = gs[dtransf].transf[2]*180.0f/M_PI, sc = gs[dtransf].transf[3] * images[img].sc;
-	SDL_FRect dest = {x*mat[0] + y*mat[1] + mat[2], x*mat[3] + y*mat[4] + mat[5], wChar*sc, hChar*sc};
-	static const SDL_FPoint ctr = { 0, 0 };
-	const float dx = wChar*mat[0] * images[img].sc, dy = wChar*mat[3] * images[img].sc;
-	for(size_t readIndex=0; str[readIndex]; x += wChar) {
-		unsigned char c = utf8ToLatin1(str, &readIndex);
-		if(c) {
-			src.x = (c%16)*wCell + margin;
-			src.y = (c/16)*hCell + margin;
-			SDL_RenderCopyExF(renderer, texture, &src, &dest, rot, &ctr, SDL_FLIP_NONE);
-		}
-		dest.x += dx;
-		dest.y += dy;
-	}
-}
-
-static void gfxFillTextProportionalFont(uint32_t font, float x, float y, const char* str) {
-	const FontResource* fnt = &fonts[font-1];
-	if(fnt->margin >= 0) {
-		gfxFillTextFixedFont(fnt->texId, x,y, fnt->margin, str);
+/// draws a laid out string at x|y, submitting all glyphs sharing a texture at once
+static void textLayoutDraw(const TextLayout* tl, float x, float y) {
+	if(!tl->numQuads)
 		return;
+	SDL_Texture* texture = NULL;
+	const SDL_Color clr = gs[dtransf].clr;
+	++glyphTick;
+	quadBatchReserve(tl->numQuads < batchQuadsMax ? tl->numQuads : batchQuadsMax);
+	for(uint32_t i=0; i<tl->numQuads; ++i) {
+		const uint32_t idx = imgSlot(tl->img[i]) < numImages ? imgSlot(tl->img[i]) : 0;
+		if(images[idx].tex != texture || batch.numQuads == batch.numQuadsMax) {
+			quadBatchFlush(texture);
+			texture = images[idx].tex;
+			glyphPageTouch(tl->img[i]);
+		}
+		const float* xyIn = &tl->xy[i*8];
+		float* xy = &batch.xy[batch.numQuads*8];
+		for(int j=0; j<8; j+=2) {
+			xy[j] = xyIn[j] + x;
+			xy[j+1] = xyIn[j+1] + y;
+		}
+		memcpy(&batch.uv[batch.numQuads*8], &tl->uv[i*8], 8*sizeof(float));
+		SDL_Color* vc = &batch.clr[batch.numQuads*4];
+		vc[0] = vc[1] = vc[2] = vc[3] = clr;
+		++batch.numQuads;
 	}
-	SDL_Texture* texture = images[fnt->texId].tex;
-	const SDL_Color* clr = &gs[dtransf].clr;
-	SDL_SetTextureColorMod(texture, clr->r, clr->g, clr->b);
-	SDL_SetTextureAlphaMod(texture, clr->a);
-	SDL_SetTextureBlendMode(texture, gs[dtransf].blendMode);
-
-	y += fnt->ascent;
-	float destX = x*mat[0] + y*mat[1] + mat[2], destY = x*mat[3] + y*mat[4] + mat[5];
-	static const SDL_FPoint ctr = { 0, 0 };
-	float rot = gs[dtransf].transf[2]*180.0f/M_PI, sc = gs[dtransf].transf[3];
-
-	for(size_t readIndex=0; str[readIndex]; ) {
-		unsigned char c = utf8ToLatin1(str, &readIndex);
-		if(c<GLYPH_MIN)
-			c = ' '; // render as space
-
-		const stbtt_bakedchar* glyph = &fnt->glyphData[c - GLYPH_MIN];
-		int wChar = glyph->x1 - glyph->x0, hChar = glyph->y1 - glyph->y0;
-		SDL_Rect src  = { .x = glyph->x0, .y = glyph->y0, .w = wChar, .h = hChar };
-		float xoff = (glyph->xoff + 0.5f)*mat[0] + (glyph->yoff + 0.5f)*mat[1];
-		float yoff = (glyph->xoff + 0.5f)*mat[3] + (glyph->yoff + 0.5f)*mat[4];
-		SDL_FRect dest = { destX + xoff, destY + yoff, wChar*sc, hChar*sc };
-		SDL_RenderCopyExF(renderer, texture, &src, &dest, rot, &ctr, SDL_FLIP_NONE);
-		destX += glyph->xadvance * mat[0];
-		destY += glyph->xadvance * mat[3];
-	}
+	quadBatchFlush(texture);
 }
 
 void gfxFillText(uint32_t font, float x, float y, const char* str) {
-	if(!font || font>numFonts)
-		gfxFillTextFixedFont(0, x,y, 0, str);
-	else
-		gfxFillTextProportionalFont(font, x,y, str);
+	if(str && str[0])
+		textLayoutDraw(textLayout(fontSlot(font), str), x, y);
 }
 
 void gfxFillTextAlign(uint32_t font, float x, float y, const char* str, int align) {
-	float width, height;
-	gfxMeasureText(font, str, &width, &height, NULL, NULL);
+	if(!str || !str[0])
+		return;
+	// one layout both provides the width and the quads to draw:
+	const TextLayout* tl = textLayout(fontSlot(font), str);
+	float height = 0.0f;
+	gfxMeasureText(font, NULL, NULL, &height, NULL, NULL);
 	if(align & GFX_ALIGN_RIGHT_TOP)
-		x-=width;
+		x-=tl->width;
 	else if(align & GFX_ALIGN_CENTER_TOP)
-		x-=width/2;
+		x-=tl->width/2;
 	if(align & GFX_ALIGN_LEFT_BOTTOM)
 		y-=height;
 	else if(align & GFX_ALIGN_LEFT_MIDDLE)
 		y-=height/2;
-	gfxFillText(font, x,y, str);
+	textLayoutDraw(tl, x,y);
 }
 
 void gfxMeasureText(uint32_t font, const char* text, float* width, float* height, float* ascent, float* descent) {
-	if(!font || font>numFonts || fonts[font-1].margin >= 0) {
-		uint32_t img = (!font || font>numFonts) ? 0 : fonts[font-1].texId;
+	font = fontSlot(font);
+	if(!font || fonts[font-1].margin >= 0) {
+		uint32_t img = !font ? 0 : imgSlot(fonts[font-1].texId);
 		if(img>=numImages)
 			img = 0;
 		const int margin = img ? fonts[font-1].margin : 0;
 		const unsigned char wChar = images[img].src.w/16 - margin*2, hChar = images[img].src.h/16 - margin*2;
-		if(width) {
-			*width = 0;
-			for(size_t readIndex=0; text[readIndex]; utf8ToLatin1(text, &readIndex))
-				*width += wChar * images[img].sc;
-		}
+		if(width)
+			*width = (text && text[0]) ? textLayout(font, text)->width : 0.0f;
 		if(height)
 			*height = hChar * images[img].sc;
 		if(ascent)
@@ -673,20 +2522,11 @@ void gfxMeasureText(uint32_t font, const char* text, float* width, float* height
 		return;
 	}
 
-	if(!fonts[font-1].texId)
+	if(!fontIsValid(font))
 		return;
 	const FontResource* fnt = &fonts[font-1];
-	if(width) {
-		*width = 0.0f;
-		if(text) for(size_t readIndex=0; text[readIndex]; ) {
-			unsigned char c = utf8ToLatin1(text, &readIndex);
-			if(c<GLYPH_MIN)
-				c = ' '; // render as space
-			c-=GLYPH_MIN;
-			const stbtt_bakedchar* glyph = &fnt->glyphData[c];
-			*width += glyph->xadvance;
-		}
-	}
+	if(width)
+		*width = (text && text[0]) ? textLayout(font, text)->width : 0.0f;
 	if(height)
 		*height = fnt->height;
 	if(ascent)
@@ -697,18 +2537,86 @@ void gfxMeasureText(uint32_t font, const char* text, float* width, float* height
 
 //--- experimental extensions --------------------------------------
 
+/// determines the visible area in untransformed coordinates as x0,y0,x1,y1
+/** The area is the bounding box of the inverse transformed viewport or clip rect, so it is
+ * conservative in case of rotations. Returns false if nothing is visible at all. */
+static bool cullBounds(float* bounds) {
+	int w, h;
+	SDL_Rect clip;
+	const bool isClipped = renderGetClipRect(&w, &h, &clip);
+	float x0 = 0.0f, y0 = 0.0f, x1 = w, y1 = h;
+	if(isClipped) {
+		x0 = fmaxf(x0, clip.x);
+		y0 = fmaxf(y0, clip.y);
+		x1 = fminf(x1, clip.x+clip.w);
+		y1 = fminf(y1, clip.y+clip.h);
+	}
+	const float det = mat[0]*mat[4] - mat[1]*mat[3];
+	if(x0>=x1 || y0>=y1 || det == 0.0f)
+		return false;
+	const float inv[] = { mat[4]/det, -mat[1]/det, (mat[1]*mat[5] - mat[4]*mat[2])/det,
+		-mat[3]/det, mat[0]/det, (mat[3]*mat[2] - mat[0]*mat[5])/det };
+	float corners[] = { x0,y0, x1,y0, x1,y1, x0,y1 };
+	transf2d(inv, 8, corners, corners);
+	bounds[0] = bounds[2] = corners[0];
+	bounds[1] = bounds[3] = corners[1];
+	for(int i=2; i<8; i+=2) {
+		bounds[0] = fminf(bounds[0], corners[i]);
+		bounds[1] = fminf(bounds[1], corners[i+1]);
+		bounds[2] = fmaxf(bounds[2], corners[i]);
+		bounds[3] = fmaxf(bounds[3], corners[i+1]);
+	}
+	// nearly singular transforms squash everything below a pixel:
+	return isfinite(bounds[0]) && isfinite(bounds[1]) && isfinite(bounds[2]) && isfinite(bounds[3]);
+}
+
+/// tests whether an image instance as drawn by quadBatchPush may intersect the visible bounds
+static bool cullImage(const float* bounds, const ImgResource* res, float x, float y, float sc, float rot) {
+	const float x0 = -res->cx*res->sc*sc, y0 = -res->cy*res->sc*sc;
+	const float x1 = x0 + res->src.w*res->sc*sc, y1 = y0 + res->src.h*res->sc*sc;
+	if(rot == 0.0f) // negative scales mirror the extents
+		return x+fminf(x0, x1) <= bounds[2] && x+fmaxf(x0, x1) >= bounds[0]
+			&& y+fminf(y0, y1) <= bounds[3] && y+fmaxf(y0, y1) >= bounds[1];
+	// bounding circle around the rotation center:
+	const float dx = fmaxf(fabsf(x0), fabsf(x1)), dy = fmaxf(fabsf(y0), fabsf(y1));
+	const float r = sqrtf(dx*dx + dy*dy);
+	return x-r <= bounds[2] && x+r >= bounds[0] && y-r <= bounds[3] && y+r >= bounds[1];
+}
+
+/// converts a tile index to int after clamping it to [lo,hi], as it may be far outside of the int range
+static inline int tileIndexClamp(float i, int lo, int hi) {
+	return (int)fmaxf((float)lo, fminf((float)hi, i));
+}
+
 void gfxDrawTiles(uint16_t tilesX, uint16_t tilesY, uint32_t stride,
 	uint32_t imgBase, const uint32_t* imgOffsets, const uint32_t* colors)
 {
 	//printf("tilesX:%u tilesY:%u stride:%u imgBase:%u imgOffsets:%i colors:%i\n", tilesX, tilesY, stride, imgBase, imgOffsets ? 1:0, colors ? 1 : 0);
-	const float w = images[imgBase].src.w, h=images[imgBase].src.h;
-	for(uint16_t j=0; j<tilesY; ++j) for(uint16_t i=0; i<tilesX; ++i) {
-		size_t index = j*stride+i;
-		if(colors)
-			gfxColor(colors[index]);
-		uint32_t img = imgOffsets ? imgBase+imgOffsets[index] : imgBase;
-		gfxDrawImage(img, i*w, j*h,0,1.0,0);
+	if(!tilesX || !tilesY || imgSlot(imgBase) >= numImages)
+		return;
+	const ImgResource* base = &images[imgSlot(imgBase)];
+	const float w = base->src.w, h = base->src.h;
+	float bounds[4];
+	if(w>0.0f && h>0.0f && cullBounds(bounds)) {
+		// visible index range, assuming all tiles share the base image's footprint.
+		// One tile of margin accounts for tile images of slightly different size.
+		const float ex0 = -base->cx*base->sc, ex1 = ex0 + w*base->sc;
+		const float ey0 = -base->cy*base->sc, ey1 = ey0 + h*base->sc;
+		const float fx0 = fminf(ex0, ex1), fx1 = fmaxf(ex0, ex1), fy0 = fminf(ey0, ey1), fy1 = fmaxf(ey0, ey1);
+		const int iMin = tileIndexClamp(floorf((bounds[0]-fx1)/w) - 1.0f, 0, tilesX);
+		const int iMax = tileIndexClamp(floorf((bounds[2]-fx0)/w) + 1.0f, -1, tilesX-1);
+		const int jMin = tileIndexClamp(floorf((bounds[1]-fy1)/h) - 1.0f, 0, tilesY);
+		const int jMax = tileIndexClamp(floorf((bounds[3]-fy0)/h) + 1.0f, -1, tilesY-1);
+		for(int j=jMin; j<=jMax; ++j) for(int i=iMin; i<=iMax; ++i) {
+			size_t index = j*stride+i;
+			if(colors)
+				gfxColor(colors[index]);
+			uint32_t img = imgOffsets ? imgBase+imgOffsets[index] : imgBase;
+			gfxDrawImage(img, i*w, j*h,0,1.0,0);
+		}
 	}
+	if(colors) // leave the same state color as if all tiles were drawn
+		gfxColor(colors[(tilesY-1)*stride + tilesX-1]);
 }
 
 void gfxDrawImages(uint32_t imgBase, uint32_t numInstances, uint32_t stride,
@@ -716,12 +2624,18 @@ void gfxDrawImages(uint32_t imgBase, uint32_t numInstances, uint32_t stride,
 {
 	int hasColors = (comps&GFX_COMP_COLOR_RGBA) != 0;
 	SDL_Color* clr = &gs[dtransf].clr;
+	SDL_Texture* texture = NULL;
+	float bounds[4];
+	if(!cullBounds(bounds))
+		bounds[0] = bounds[1] = INFINITY, bounds[2] = bounds[3] = -INFINITY;
+	quadBatchReserve(numInstances < batchQuadsMax ? numInstances : batchQuadsMax);
 	for(uint32_t i=0; i<numInstances; ++i) {
 		const float* data = &arr[i*stride];
 		uint32_t img = imgBase, j=0;
 		if(comps & GFX_COMP_IMG_OFFSET)
 			img += data[j++];
-		if(!img || img >= numImages)
+		img = imgSlot(img);
+		if(!img || img >= numImages || !images[img].tex)
 			continue;
 
 		float x = data[j++], y = data[j++];
@@ -734,47 +2648,218 @@ void gfxDrawImages(uint32_t imgBase, uint32_t numInstances, uint32_t stride,
 			clr->a = (comps & GFX_COMP_COLOR_A) ? data[j++] : clr->a;
 			if(!clr->a)
 				continue;
-			SDL_SetRenderDrawColor(renderer, clr->r, clr->g, clr->b, clr->a);
 		}
 		//printf("x:%.1f y:%.1f rot:%.1f sc:%.2f r:%u g:%u b:%u a:%u\n", x,y,rot,sc, clr->r, clr->g, clr->b, clr->a);
-		ImgResource* res = &images[img];
-		gfxDrawImageEx(res->tex, res->src.x,res->src.y,res->src.w,res->src.h,
-			x,y,res->src.w*res->sc*sc,res->src.h*res->sc*sc, res->cx,res->cy,rot,0);
+		const ImgResource* res = &images[img];
+		if(!cullImage(bounds, res, x, y, sc, rot))
+			continue;
+		if(res->tex != texture || batch.numQuads == batch.numQuadsMax) {
+			quadBatchFlush(texture);
+			texture = res->tex;
+		}
+		quadBatchPush(res, x, y, sc, rot, *clr);
 	}
+	quadBatchFlush(texture);
+	if(hasColors)
+		renderDrawColor(clr->r, clr->g, clr->b, clr->a);
 }
 
 void gfxFillTriangles(uint32_t numVertices, const float* coords,
 	const uint32_t* colors, uint32_t numIndices, const uint32_t* indices)
 {
 	const SDL_Color* clr = &gs[dtransf].clr;
-	static float coordsTrans[1000*6*2];
-	const uint32_t numTrianglesMax = 2000;
-	for(uint32_t offset=0; offset<numVertices; offset+=numTrianglesMax*3*2) {
-		uint32_t numCoords = numVertices - offset;
-		if(numCoords>numTrianglesMax*3*2)
-			numCoords = numTrianglesMax*3*2;
-		arrayTransf2d(mat, numCoords*2, &coords[offset*2], coordsTrans);
-		SDL_RenderGeometryRaw(renderer, NULL, coordsTrans, 2*sizeof(float),
-			(colors ? (SDL_Color*)(colors+offset) : clr), colors ? sizeof(uint32_t) : 0, NULL, 0, numCoords,
-			indices, numIndices, indices? 4 : 0);
-	}
+	float* coordsTrans = (float*)arenaAlloc(numVertices*2*sizeof(float));
+	transf2d(mat, numVertices*2, coords, coordsTrans);
+	renderGeometry(NULL, coordsTrans,
+		(colors ? (const SDL_Color*)colors : clr), colors ? sizeof(uint32_t) : 0, NULL, numVertices,
+		indices, numIndices, indices? 4 : 0);
 }
 
 void gfxTexTriangles(uint32_t img, uint32_t numVertices, const float* coords, const float* uvCoords,
 	const uint32_t* colors, uint32_t numIndices, const uint32_t* indices)
 {
+	img = imgSlot(img);
 	SDL_Texture* tex = (!img || img >= numImages) ? NULL : images[img].tex;
 	const SDL_Color* clr = &gs[dtransf].clr;
+	float* coordsTrans = (float*)arenaAlloc(numVertices*2*sizeof(float));
+	transf2d(mat, numVertices*2, coords, coordsTrans);
+	float* uv = NULL;
+	if(tex) { // texture coordinates of atlas packed images refer to their region of the atlas page
+		const ImgResource* res = &images[img];
+		uv = (float*)arenaAlloc(numVertices*2*sizeof(float));
+		for(uint32_t i=0; i<numVertices*2; i+=2) {
+			uv[i] = (res->area.x + uvCoords[i]*res->area.w)/(float)res->texW;
+			uv[i+1] = (res->area.y + uvCoords[i+1]*res->area.h)/(float)res->texH;
+		}
+	}
+	renderGeometry(tex, coordsTrans,
+		(colors ? (const SDL_Color*)colors : clr), colors ? sizeof(uint32_t) : 0, uv, numVertices,
+		indices, numIndices, indices? 4 : 0);
+}
+
+//--- retained meshes ----------------------------------------------
+
+/// vertex and index data uploaded once and drawn repeatedly under varying transformations
+typedef struct {
+	float* xy;
+	/// texture coordinates, NULL for untextured meshes
+	float* uv;
+	/// vertex colors, NULL if drawn in the current color
+	SDL_Color* clr;
+	int* indices;
+	uint32_t numVertices, numIndices;
+	/// handle of the image providing the texture
+	uint32_t img;
+	/// bounding box x0,y0,x1,y1 in mesh coordinates
+	float bbox[4];
+	/// incremented whenever the slot is released, invalidating outstanding handles to it
+	uint32_t gen;
+} MeshResource;
+
+static MeshResource* meshes = NULL;
+/// meshes are numbered from 1, released ones are recycled via freeMeshes
+static uint32_t numMeshes=0, numMeshesMax=0;
+static uint32_t* freeMeshes=NULL;
+static uint32_t numFreeMeshes=0, numFreeMeshesMax=0;
+
+/// returns the mesh number a mesh handle refers to, or 0 if the handle is invalid or stale
+static inline uint32_t meshSlot(uint32_t handle) {
+	const uint32_t mesh = handle & HANDLE_INDEX_MASK;
+	return (mesh && mesh<=numMeshes && meshes[mesh-1].xy
+		&& meshes[mesh-1].gen == handle>>HANDLE_INDEX_BITS) ? mesh : 0;
+}
+
+uint32_t gfxMeshCreate(uint32_t numVertices, const float* coords, const float* uvCoords,
+	const uint32_t* colors, uint32_t numIndices, const uint32_t* indices, uint32_t img)
+{
+	if(!numVertices || numVertices > HANDLE_INDEX_MASK)
+		return 0;
+	for(uint32_t i=0; indices && i<numIndices; ++i)
+		if(indices[i] >= numVertices)
+			return 0;
+
+	uint32_t mesh;
+	if(numFreeMeshes)
+		mesh = freeMeshes[--numFreeMeshes];
+	else {
+		if(numMeshes == numMeshesMax) {
+			numMeshesMax = numMeshesMax ? numMeshesMax*2 : 16;
+			meshes = (MeshResource*)realloc(meshes, numMeshesMax*sizeof(MeshResource));
+		}
+		meshes[numMeshes].gen = 0;
+		mesh = ++numMeshes;
+	}
+	MeshResource* m = &meshes[mesh-1];
+	m->numVertices = numVertices;
+	m->numIndices = indices ? numIndices : 0;
+	const uint32_t slot = uvCoords ? imgSlot(img) : UINT32_MAX;
+	m->img = (slot < numImages && images[slot].tex) ? img : 0;
+	m->xy = (float*)malloc(numVertices*2*sizeof(float));
+	memcpy(m->xy, coords, numVertices*2*sizeof(float));
+	m->uv = NULL;
+	if(m->img) { // as for gfxTexTriangles, atlas packed images map to their region of the atlas page
+		const ImgResource* res = &images[slot];
+		m->uv = (float*)malloc(numVertices*2*sizeof(float));
+		for(uint32_t i=0; i<numVertices*2; i+=2) {
+			m->uv[i] = (res->area.x + uvCoords[i]*res->area.w)/(float)res->texW;
+			m->uv[i+1] = (res->area.y + uvCoords[i+1]*res->area.h)/(float)res->texH;
+		}
+	}
+	m->clr = NULL;
+	if(colors) {
+		m->clr = (SDL_Color*)malloc(numVertices*sizeof(SDL_Color));
+		memcpy(m->clr, colors, numVertices*sizeof(SDL_Color));
+	}
+	m->indices = NULL;
+	if(m->numIndices) {
+		m->indices = (int*)malloc(m->numIndices*sizeof(int));
+		memcpy(m->indices, indices, m->numIndices*sizeof(int));
+	}
+
+	float* bbox = m->bbox;
+	bbox[0] = bbox[2] = coords[0];
+	bbox[1] = bbox[3] = coords[1];
+	for(uint32_t i=2; i<numVertices*2; i+=2) {
+		bbox[0] = fminf(bbox[0], coords[i]);
+		bbox[1] = fminf(bbox[1], coords[i+1]);
+		bbox[2] = fmaxf(bbox[2], coords[i]);
+		bbox[3] = fmaxf(bbox[3], coords[i+1]);
+	}
+	return mesh | (m->gen & HANDLE_GEN_MASK)<<HANDLE_INDEX_BITS;
+}
+
+void gfxMeshDraw(uint32_t mesh, float x, float y, float rot, float sc) {
+	mesh = meshSlot(mesh);
+	if(!mesh)
+		return;
+	const MeshResource* m = &meshes[mesh-1];
+	SDL_Texture* tex = NULL;
+	if(m->img) {
+		const uint32_t img = imgSlot(m->img);
+		if(img >= numImages || !images[img].tex)
+			return;
+		tex = images[img].tex;
+	}
+	// mesh placement, same as gfxTransform(x, y, rot, sc):
+	const float c = cosf(rot)*sc, s = sinf(rot)*sc;
+	const float local[] = { c, -s, x, s, c, y };
+	float bounds[4], corners[] = { m->bbox[0],m->bbox[1], m->bbox[2],m->bbox[1], m->bbox[2],m->bbox[3], m->bbox[0],m->bbox[3] };
+	if(!cullBounds(bounds))
+		return;
+	transf2d(local, 8, corners, corners);
+	float x0 = corners[0], y0 = corners[1], x1 = x0, y1 = y0;
+	for(int i=2; i<8; i+=2) {
+		x0 = fminf(x0, corners[i]);
+		y0 = fminf(y0, corners[i+1]);
+		x1 = fmaxf(x1, corners[i]);
+		y1 = fmaxf(y1, corners[i+1]);
+	}
+	if(x0 > bounds[2] || x1 < bounds[0] || y0 > bounds[3] || y1 < bounds[1])
+		return;
+	const float transf[] = {
+		mat[0]*local[0] + mat[1]*local[3], mat[0]*local[1] + mat[1]*local[4], mat[0]*x + mat[1]*y + mat[2],
+		mat[3]*local[0] + mat[4]*local[3], mat[3]*local[1] + mat[4]*local[4], mat[3]*x + mat[4]*y + mat[5] };
+	float* xy = (float*)arenaAlloc(m->numVertices*2*sizeof(float));
+	transf2d(transf, m->numVertices*2, m->xy, xy);
+	if(tex && !dcb.enabled) // vertex colors carry the modulation, as for batched quads
+		textureState(tex, (SDL_Color){ 255, 255, 255, 255 }, gs[dtransf].blendMode);
+	renderGeometry(tex, xy, m->clr ? m->clr : &gs[dtransf].clr, m->clr ? sizeof(SDL_Color) : 0,
+		m->uv, m->numVertices, m->indices, m->numIndices, m->indices ? sizeof(int) : 0);
+}
+
+void gfxMeshRelease(uint32_t mesh) {
+	mesh = meshSlot(mesh);
+	if(!mesh)
+		return;
+	MeshResource* m = &meshes[mesh-1];
+	free(m->xy);
+	free(m->uv);
+	free(m->clr);
+	free(m->indices);
+	m->xy = m->uv = NULL;
+	m->clr = NULL;
+	m->indices = NULL;
+	if(++m->gen > HANDLE_GEN_MASK) // retired
+		return;
+	if(numFreeMeshes == numFreeMeshesMax) {
+		numFreeMeshesMax = numFreeMeshesMax ? numFreeMeshesMax*2 : 16;
+		freeMeshes = (uint32_t*)realloc(freeMeshes, numFreeMeshesMax*sizeof(uint32_t));
+	}
+	freeMeshes[numFreeMeshes++] = mesh;
+}
 
-	static float coordsTrans[1000*6*2];
-	const uint32_t numTrianglesMax = 2000;
-	for(uint32_t offset=0; offset<numVertices; offset+=numTrianglesMax*3*2) {
-		uint32_t numCoords = numVertices - offset;
-		if(numCoords>numTrianglesMax*3*2)
-			numCoords = numTrianglesMax*3*2;
-		arrayTransf2d(mat, numCoords*2, &coords[offset*2], coordsTrans);
-		SDL_RenderGeometryRaw(renderer, tex, coordsTrans, 2*sizeof(float),
-			(colors ? (SDL_Color*)(colors+offset) : clr), colors ? sizeof(uint32_t) : 0, uvCoords, 2*sizeof(float), numCoords,
-			indices, numIndices, indices? 4 : 0);
+/// releases all meshes and forgets their slots
+static void meshesRelease() {
+	for(uint32_t i=0; i<numMeshes; ++i) {
+		free(meshes[i].xy);
+		free(meshes[i].uv);
+		free(meshes[i].clr);
+		free(meshes[i].indices);
 	}
+	free(meshes);
+	meshes = NULL;
+	numMeshes = numMeshesMax = 0;
+	free(freeMeshes);
+	freeMeshes = NULL;
+	numFreeMeshes = numFreeMeshesMax = 0;
 }
@@ -21,10 +21,18 @@ extern void gfxTextureFiltering(int level);
 /// uploads an image from a memory buffer and returns a handle (0 in case of an error)
 /** rMask parameter allows to specify data layout as RGB(A) =0xff000000 or (A)BGR = 0xff */
 extern uint32_t gfxImageUpload(const unsigned char* data, int w, int h, int d, uint32_t rMask);
+/// creates a transparent RGBA image to be filled via gfxImageUpdate and returns a handle (0 in case of an error)
+extern uint32_t gfxImageCreate(int w, int h);
+/// replaces a rectangular region of an image created by gfxImageCreate by RGBA pixel data
+extern int gfxImageUpdate(uint32_t img, int x, int y, int w, int h, const unsigned char* rgba);
 /// loads an SVG image from string to graphics memory and returns a handle
 extern uint32_t gfxSVGUpload(const char* svg, size_t svgSz, float scale);
 /// defines an image tile based on an already existing parent image
+/** x and y are relative to the origin of the parent's texture, or of its region for atlas packed parents */
 extern uint32_t gfxImageTile(uint32_t parent, int x, int y, int w, int h);
+/// defines an image packed into a region of an atlas page image, which behaves like an image of its own
+/** Tile coordinates and texture coordinates of gfxTexTriangles and gfxMeshCreate refer to the region. */
+extern uint32_t gfxImageAtlasTile(uint32_t page, int x, int y, int w, int h);
 /// defines image tiles based on an already existing parent image by specifing the number of tiles in x and y dimension and a border width
 /** \return image handle of the first (left upper) tile */
 extern uint32_t gfxImageTileGrid(uint32_t parent, uint16_t tilesX, uint16_t tilesY, uint16_t border);
@@ -33,16 +41,36 @@ extern void gfxImageSetCenter(uint32_t img, float cx, float cy);
 /// returns width and height of image in pixels
 extern void gfxImageDimensions(uint32_t img, int* w, int* h);
 /// releases an image from graphics memory
+/** Its handle slot is recycled by images created later, stale handles to it are ignored by all functions. */
 extern void gfxImageRelease(uint32_t img);
 /// uploads a TTF font resource and returns handle
 extern uint32_t gfxFontUpload(void* data, size_t dataSize, float fontSize);
+/// uploads a TTF font resource whose glyphs are derived from cached signed distance fields and returns handle
+/** Additional sizes created by gfxFontResize() reuse the distance fields instead of rasterizing outlines again. */
+extern uint32_t gfxFontUploadSDF(void* data, size_t dataSize, float fontSize);
+/// creates another size of an uploaded TTF font sharing its font data and returns handle (0 for image fonts)
+extern uint32_t gfxFontResize(uint32_t font, float fontSize);
 /// creates font resource based on a texture containing a fixed 16x16 grid of glyphs
 extern uint32_t gfxFontFromImage(uint32_t img, int margin);
-/// releases a font from graphics memory
+/// releases a font from graphics memory, stale handles to it refer to the built-in font afterwards
 extern void gfxFontRelease(uint32_t font);
 
 extern size_t gfxCanvasCreate(int w, int h, uint32_t color);
 extern uint32_t gfxCanvasUpload(size_t canvas);
+/// creates a retained render layer of w*h pixels and returns its image handle
+/** A layer is a render target texture that keeps its content across frames and is drawn like any other image. */
+extern uint32_t gfxLayerCreate(int w, int h);
+/// redirects subsequent drawing into a layer after clearing it, layers may be nested
+/** \return 0 on success */
+extern int gfxLayerBegin(uint32_t img, uint32_t clearColor);
+/// finishes drawing into the current layer, marks it clean, and returns to the previous render target
+extern void gfxLayerEnd();
+/// returns true if a layer has not been drawn yet or was invalidated since
+extern bool gfxLayerDirty(uint32_t img);
+/// marks a layer as needing to be redrawn
+extern void gfxLayerInvalidate(uint32_t img);
+/// marks all layers as needing to be redrawn, for example after render targets were reset
+extern void gfxLayersInvalidate();
 extern uint32_t gfxVideoCanvasCreate(int w, int h);
 extern int gfxVideoCanvasUpdate(uint32_t img,
 	const uint8_t* yData, int yPitch, const uint8_t* uData, int uPitch, const uint8_t* vData, int vPitch);
@@ -51,16 +79,51 @@ extern int gfxVideoCanvasUpdate(uint32_t img,
 ///@{ render state/context:
 extern void gfxBeginFrame(uint32_t clearColor);
 extern void gfxEndFrame();
+/// submits all pending draw calls of the current frame without presenting it
+extern void gfxFinishFrame();
+/// presents the finished frame, gfxEndFrame() is equivalent to gfxFinishFrame() followed by gfxPresent()
+extern void gfxPresent();
+/// turns deferred rendering on or off
+/** If enabled, draw calls are recorded into a per-frame command buffer flushed at gfxEndFrame.
+ * Commands sharing texture and blend mode are merged into single submissions unless this would change painter's order. */
+extern void gfxDeferredRendering(bool enabled);
+/// turns pipelined rendering of the CPU rasterizer on or off, returns false if it is not available
+/** Only supported by the CPU rasterizer backend, as SDL renderers may only be used by a single thread,
+ * and ignored otherwise. If enabled, a render thread replays and rasterizes the commands recorded during
+ * a frame while the next frame is already computed, delaying its presentation by one frame. Turning it
+ * off presents the last replayed frame. Implies deferred rendering, which stays on when pipelining is
+ * turned off again. Operations needing the rasterizer mid-frame wait for the render thread, namely clip
+ * rect and render target changes such as layers, and creating, updating, or destroying textures, which
+ * includes loading, updating and releasing images, video canvas updates, and newly rasterized glyph pages. */
+extern bool gfxPipelinedRendering(bool enabled);
+/// returns the number of mid-frame operations that waited for the busy render thread during the last frame
+extern uint32_t gfxPipelineStalls();
+/// returns the number of draw calls recorded and actually submitted during the last frame in deferred rendering mode
+extern void gfxDrawCallCounters(uint32_t* recorded, uint32_t* submitted);
+/// returns the number of renderer and texture state changes issued to SDL and skipped as redundant during the last frame
+extern void gfxStateChangeCounters(uint32_t* issued, uint32_t* skipped);
+/// returns the number of draw calls submitted to the renderer, texture switches between them, and vertices during the last frame
+extern void gfxRenderCounters(uint32_t* drawCalls, uint32_t* textureSwitches, uint32_t* vertices);
 /// resets state to its initial values
 extern void gfxStateReset();
+/// resets the current state to its initial values, keeping the states saved on the stack
+extern void gfxStateResetTop();
 /// pushes current state onto a stack
-/** 7 stacked states supported */
-extern void gfxStateSave();
+/** up to gfxStateStackDepth()-1 stacked states supported, further saves are ignored and return false */
+extern bool gfxStateSave();
 /// restores previous state from stack
 extern void gfxStateRestore();
+/// sets the maximum number of states on the stack including the current one, defaults to 64
+extern void gfxStateStackDepth(uint32_t depth);
+/// renders via the multi-threaded tile-based CPU rasterizer instead of the SDL_Renderer
+/** must be called before gfxInit. numThreads 0 keeps the SDL_Renderer, negative values mean one thread per CPU core. */
+extern void gfxSoftwareRasterizer(int numThreads);
 
 /// multiplies current transformation with this additional transformation
 extern void gfxTransform(float x, float y, float rot, float sc);
+/// multiplies current transformation with an arbitrary affine 2x3 matrix
+/** m is row-major, x' = m[0]*x + m[1]*y + m[2], y' = m[3]*x + m[4]*y + m[5] */
+extern void gfxTransformMatrix(const float* m);
 /// multiplies current transformation with this additional 3D transformation
 extern void gfxTransf3d(float x, float y, float z, float rotX, float rotY, float rotZ, float sc);
 /// sets current color
@@ -88,8 +151,10 @@ extern void gfxDrawLine(float x0, float y0, float x1, float y1);
 extern void gfxDrawLineStrip(uint32_t numCoords, const float* coords);
 /// draws a closed line loop
 extern void gfxDrawLineLoop(uint32_t numCoords, const float* coords);
-// draws an array of points using a point sprite (for example GFX_IMG_CIRCLE) and current line width as size
-extern void gfxDrawPoints(uint32_t numCoords, const float* coords, uint32_t img);
+/// draws an array of points using a point sprite (for example GFX_IMG_CIRCLE) and current line width as size
+/** colors (in vertex color byte order, as for gfxFillTriangles) and sizes optionally override the current
+ * color and line width per point. All points are submitted as quads in a single geometry call. */
+extern void gfxDrawPoints(uint32_t numCoords, const float* coords, uint32_t img, const uint32_t* colors, const float* sizes);
 /// draws a filled triangle
 extern void gfxFillTriangle(float x0, float y0, float x1, float y1, float x2, float y2);
 /// draws an image
@@ -145,6 +210,17 @@ extern void gfxDrawImages(uint32_t imgBase, uint32_t numInstances, uint32_t stri
 extern void gfxFillTriangles(uint32_t numVertices, const float* coords,
 	const uint32_t* colors, uint32_t numIndices, const uint32_t* indices);
 /// draws textured triangles with optional vertex colors and indices
+/** uvCoords in range 0..1 refer to the texture of image img, or its region for atlas packed images */
 extern void gfxTexTriangles(uint32_t img, uint32_t numVertices, const float* coords, const float* uvCoords,
 	const uint32_t* colors, uint32_t numIndices, const uint32_t* indices);
+/// creates a retained mesh from copies of the given vertex and index data
+/** uvCoords refer to image img as for gfxTexTriangles, and are ignored if img is invalid. colors and indices
+ * are optional as for gfxTexTriangles.
+ * \return mesh handle, or 0 if an index is out of range */
+extern uint32_t gfxMeshCreate(uint32_t numVertices, const float* coords, const float* uvCoords,
+	const uint32_t* colors, uint32_t numIndices, const uint32_t* indices, uint32_t img);
+/// draws a mesh translated by x|y, rotated by rot, and scaled by sc, on top of the current transformation
+/** Untextured meshes without vertex colors are drawn in the current color. Meshes outside the visible area are skipped. */
+extern void gfxMeshDraw(uint32_t mesh, float x, float y, float rot, float sc);
+extern void gfxMeshRelease(uint32_t mesh);
 ///@}
@@ -37,6 +37,7 @@ uint32_t readUint32Array(duk_context *ctx, duk_idx_t idx, uint32_t** arr, uint32
 			(*buf)[i] = duk_to_uint32(ctx, -1);
 			duk_pop(ctx);
 		}
+		return n;
 	}
 	return n/sizeof(uint32_t);
 }
@@ -168,9 +169,31 @@ static duk_ret_t dk_gfxTransform(duk_context *ctx) {
 	return 1;
 }
 
+/**
+ * @function gfx.transformMatrix
+ * multiplies the current transformation by an affine matrix, allowing non-uniform scaling and shearing
+ *
+ * The parameters follow the canvas 2D context convention: x' = a*x + c*y + e, y' = b*x + d*y + f
+ * @param {number} a - horizontal scaling
+ * @param {number} b - vertical shearing
+ * @param {number} c - horizontal shearing
+ * @param {number} d - vertical scaling
+ * @param {number} [e=0] - horizontal translation
+ * @param {number} [f=0] - vertical translation
+ * @returns {object} this gfx object for chained calls
+ */
+static duk_ret_t dk_gfxTransformMatrix(duk_context *ctx) {
+	const float m[] = {
+		duk_to_number(ctx, 0), duk_to_number(ctx, 2), duk_get_number_default(ctx, 4, 0.0),
+		duk_to_number(ctx, 1), duk_to_number(ctx, 3), duk_get_number_default(ctx, 5, 0.0) };
+	gfxTransformMatrix(m);
+	duk_push_this(ctx);
+	return 1;
+}
+
 /**
  * @function gfx.save
- * saves current rendering state, can be nested up to 7 times
+ * saves current rendering state, can be nested up to 63 times by default
  * @returns {object} this gfx object for chained calls
  */
 static duk_ret_t dk_gfxStateSave(duk_context *ctx) {
@@ -281,15 +304,33 @@ static duk_ret_t dk_gfxDrawLineLoop(duk_context *ctx) {
 /**
  * @function gfx.drawPoints
  * draws a series points using an optionally defined image as point sprite and the current line width.
+ * All points are submitted in a single batch, optional per-point colors and sizes override the current color and line width.
  * @param {array|Float32Array} arr - array of vertex ordinates
  * @param {number} [img=gfx.IMG_CIRCLE] - point sprite image handle
+ * @param {array|Uint32Array} [colors] - optional array of point colors, in the same format as gfx.fillTriangles vertex colors
+ * @param {array|Float32Array} [sizes] - optional array of point sizes
  */
 static duk_ret_t dk_gfxDrawPoints(duk_context *ctx) {
 	float *arr, *buf;
 	uint32_t n = readFloatArray(ctx, 0, &arr, &buf);
 	uint32_t img = duk_get_uint_default(ctx, 1, GFX_IMG_CIRCLE);
-	gfxDrawPoints(n/2, arr, img);
+	uint32_t *colors = NULL, *colorBuf = NULL;
+	float *sizes = NULL, *sizeBuf = NULL;
+	if(!duk_is_null_or_undefined(ctx, 2) && readUint32Array(ctx, 2, &colors, &colorBuf) < n/2) {
+		free(buf);
+		free(colorBuf);
+		return duk_error(ctx, DUK_ERR_ERROR, "point colors array size does not fit coordinate size");
+	}
+	if(!duk_is_null_or_undefined(ctx, 3) && readFloatArray(ctx, 3, &sizes, &sizeBuf) < n/2) {
+		free(buf);
+		free(colorBuf);
+		free(sizeBuf);
+		return duk_error(ctx, DUK_ERR_ERROR, "point sizes array size does not fit coordinate size");
+	}
+	gfxDrawPoints(n/2, arr, img, colors, sizes);
 	free(buf);
+	free(colorBuf);
+	free(sizeBuf);
 	return 0;
 }
 
@@ -497,6 +538,200 @@ static duk_ret_t dk_gfxDrawSprite(duk_context *ctx) {
 	return 0;
 }
 
+/// returns the image handle of a layer object
+static uint32_t layerImage(duk_context *ctx, duk_idx_t idx) {
+	uint32_t img = 0;
+	if(duk_is_object(ctx, idx)) {
+		duk_get_prop_literal(ctx, idx, "image");
+		img = duk_to_uint32(ctx, -1);
+		duk_pop(ctx);
+	}
+	return img;
+}
+
+/**
+ * @function layer.begin
+ * clears the layer and redirects subsequent drawing operations into it until layer.end() is called
+ * @param {number|string|array} [color=0] - clear color, transparent by default
+ * @returns {object} the gfx object for chained calls
+ */
+static duk_ret_t dk_layerBegin(duk_context *ctx) {
+	duk_push_this(ctx);
+	uint32_t img = layerImage(ctx, -1);
+	uint32_t color = duk_is_undefined(ctx, 0) ? 0 : readColor(ctx, 0);
+	if(gfxLayerBegin(img, color)!=0)
+		return duk_error(ctx, DUK_ERR_ERROR, "layer %u cannot be drawn into", img);
+	duk_get_global_literal(ctx, DUK_HIDDEN_SYMBOL("gfx"));
+	return 1;
+}
+
+/**
+ * @function layer.end
+ * finishes drawing into the layer and marks it as up to date
+ * @returns {object} this layer object
+ */
+static duk_ret_t dk_layerEnd(duk_context *ctx) {
+	gfxLayerEnd();
+	duk_push_this(ctx);
+	return 1;
+}
+
+/**
+ * @function layer.invalidate
+ * marks the layer's content as outdated, so that gfx.drawLayer() calls its draw callback again
+ * @returns {object} this layer object
+ */
+static duk_ret_t dk_layerInvalidate(duk_context *ctx) {
+	duk_push_this(ctx);
+	gfxLayerInvalidate(layerImage(ctx, -1));
+	return 1;
+}
+
+/**
+ * @function layer.dirty
+ * tells whether the layer needs to be redrawn, because it is new, invalidated, or its content got lost
+ * @returns {boolean} true if the layer needs to be redrawn
+ */
+static duk_ret_t dk_layerDirty(duk_context *ctx) {
+	duk_push_this(ctx);
+	duk_push_boolean(ctx, gfxLayerDirty(layerImage(ctx, -1)));
+	return 1;
+}
+
+/**
+ * @function gfx.createLayer
+ * creates a retained render layer that keeps its content across frames
+ *
+ * Static content like backgrounds or HUD frames can be drawn into a layer once and
+ * then be composited each frame with a single gfx.drawLayer() call.
+ * Release a layer no longer needed via app.releaseResource(layer.image, 'image').
+ * @param {number} width - layer width in pixels
+ * @param {number} height - layer height in pixels
+ * @param {function} [draw] - optional callback function(gfx, width, height) drawing the layer's content, called by gfx.drawLayer() whenever the layer is dirty
+ * @returns {object} layer object having image, width, and height properties and begin, end, invalidate, and dirty methods
+ */
+static duk_ret_t dk_gfxCreateLayer(duk_context *ctx) {
+	int width = duk_to_int(ctx, 0), height = duk_to_int(ctx, 1);
+	uint32_t img = gfxLayerCreate(width, height);
+	if(!img)
+		return duk_error(ctx, DUK_ERR_ERROR, "creating layer of size %i x %i failed", width, height);
+	duk_push_object(ctx);
+	duk_push_uint(ctx, img);
+	duk_put_prop_literal(ctx, -2, "image");
+	duk_push_int(ctx, width);
+	duk_put_prop_literal(ctx, -2, "width");
+	duk_push_int(ctx, height);
+	duk_put_prop_literal(ctx, -2, "height");
+	if(duk_is_function(ctx, 2)) {
+		duk_dup(ctx, 2);
+		duk_put_prop_literal(ctx, -2, "draw");
+	}
+	duk_push_c_function(ctx, dk_layerBegin, 1);
+	duk_put_prop_literal(ctx, -2, "begin");
+	duk_push_c_function(ctx, dk_layerEnd, 0);
+	duk_put_prop_literal(ctx, -2, "end");
+	duk_push_c_function(ctx, dk_layerInvalidate, 0);
+	duk_put_prop_literal(ctx, -2, "invalidate");
+	duk_push_c_function(ctx, dk_layerDirty, 0);
+	duk_put_prop_literal(ctx, -2, "dirty");
+	return 1;
+}
+
+/**
+ * @function gfx.drawLayer
+ * draws a layer, first redrawing its content via its draw callback if the layer is dirty
+ * @param {object} layer - layer object created by gfx.createLayer()
+ * @param {number} [x=0] - destination X position
+ * @param {number} [y=0] - destination Y position
+ * @param {number} [angle=0] - rotation angle in radians
+ * @param {number} [scale=1] - scale factor
+ */
+static duk_ret_t dk_gfxDrawLayer(duk_context *ctx) {
+	uint32_t img = layerImage(ctx, 0);
+	if(!img)
+		return duk_error(ctx, DUK_ERR_REFERENCE_ERROR, "invalid layer %s", duk_to_string(ctx, 0));
+	float x = duk_get_number_default(ctx, 1, 0.0);
+	float y = duk_get_number_default(ctx, 2, 0.0);
+	float rot = duk_get_number_default(ctx, 3, 0.0);
+	float scale = duk_get_number_default(ctx, 4, 1.0);
+
+	if(gfxLayerDirty(img) && duk_get_prop_literal(ctx, 0, "draw") && duk_is_function(ctx, -1)
+		&& gfxLayerBegin(img, 0)==0)
+	{
+		duk_get_global_literal(ctx, DUK_HIDDEN_SYMBOL("gfx"));
+		duk_get_prop_literal(ctx, 0, "width");
+		duk_get_prop_literal(ctx, 0, "height");
+		duk_int_t rc = duk_pcall(ctx, 3);
+		gfxLayerEnd(); // also in case of an error, so that drawing continues on the previous target
+		if(rc != DUK_EXEC_SUCCESS)
+			return duk_throw(ctx);
+	}
+	gfxDrawImage(img, x, y, rot, scale, 0);
+	return 0;
+}
+
+/**
+ * @function gfx.createMesh
+ * creates a retained mesh of triangles, keeping a native copy of its vertex and index data
+ *
+ * Unlike gfx.fillTriangles(), static geometry like level outlines is only passed and converted
+ * once, and each gfx.drawMesh() call merely applies the current transformation.
+ * Release a mesh no longer needed via app.releaseResource(mesh, 'mesh').
+ * @param {array|Float32Array} coords - array of vertex ordinates
+ * @param {array|Float32Array} [uvs] - optional array of texture coordinates in range 0..1 of img, one pair per vertex
+ * @param {array|Uint32Array} [colors] - optional array of vertex colors, in the same format as gfx.fillTriangles vertex colors
+ * @param {array|Uint32Array} [indices] - optional array of vertex indices, three per triangle
+ * @param {number} [img] - handle of the image providing the texture of a textured mesh
+ * @returns {number} mesh handle
+ */
+static duk_ret_t dk_gfxCreateMesh(duk_context *ctx) {
+	float *coords, *coordBuf, *uvs = NULL, *uvBuf = NULL;
+	uint32_t *colors = NULL, *colorBuf = NULL, *indices = NULL, *indexBuf = NULL;
+	const uint32_t n = readFloatArray(ctx, 0, &coords, &coordBuf);
+	uint32_t numIndices = 0, img = duk_get_uint_default(ctx, 4, 0);
+	const char* err = NULL;
+	if(n<2)
+		err = "mesh coordinates missing";
+	else if(img && !duk_is_null_or_undefined(ctx, 1) && readFloatArray(ctx, 1, &uvs, &uvBuf) != n)
+		err = "mesh texture coordinates array size does not fit coordinate size";
+	else if(!duk_is_null_or_undefined(ctx, 2) && readUint32Array(ctx, 2, &colors, &colorBuf) != n/2)
+		err = "mesh colors array size does not fit coordinate size";
+	else if(!duk_is_null_or_undefined(ctx, 3) && !(numIndices = readUint32Array(ctx, 3, &indices, &indexBuf)))
+		err = "mesh indices missing";
+	uint32_t mesh = err ? 0 : gfxMeshCreate(n/2, coords, uvs, colors, numIndices, indices, img);
+	if(!err && !mesh)
+		err = "mesh index out of range";
+	free(coordBuf);
+	free(uvBuf);
+	free(colorBuf);
+	free(indexBuf);
+	if(err)
+		return duk_error(ctx, DUK_ERR_ERROR, err);
+	duk_push_uint(ctx, mesh);
+	return 1;
+}
+
+/**
+ * @function gfx.drawMesh
+ * draws a mesh created by gfx.createMesh(), untextured meshes without vertex colors use the current color
+ * @param {number} mesh - mesh handle
+ * @param {number} [x=0] - destination X position
+ * @param {number} [y=0] - destination Y position
+ * @param {number} [angle=0] - rotation angle in radians
+ * @param {number} [scale=1] - scale factor
+ */
+static duk_ret_t dk_gfxDrawMesh(duk_context *ctx) {
+	uint32_t mesh = duk_get_uint(ctx, 0);
+	if(!mesh)
+		return duk_error(ctx, DUK_ERR_REFERENCE_ERROR, "invalid mesh handle %s", duk_to_string(ctx, 0));
+	float x = duk_get_number_default(ctx, 1, 0.0);
+	float y = duk_get_number_default(ctx, 2, 0.0);
+	float rot = duk_get_number_default(ctx, 3, 0.0);
+	float scale = duk_get_number_default(ctx, 4, 1.0);
+	gfxMeshDraw(mesh, x, y, rot, scale);
+	return 0;
+}
+
 void bindGraphics(duk_context *ctx) {
 	duk_push_object(ctx);
 
@@ -510,6 +745,8 @@ void bindGraphics(duk_context *ctx) {
 	duk_put_prop_string(ctx, -2, "clipRect");
 	duk_push_c_function(ctx, dk_gfxTransform, 4);
 	duk_put_prop_string(ctx, -2, "transform");
+	duk_push_c_function(ctx, dk_gfxTransformMatrix, 6);
+	duk_put_prop_string(ctx, -2, "transformMatrix");
 	duk_push_c_function(ctx, dk_gfxStateSave, 0);
 	duk_put_prop_string(ctx, -2, "save");
 	duk_push_c_function(ctx, dk_gfxStateRestore, 0);
@@ -531,7 +768,7 @@ void bindGraphics(duk_context *ctx) {
 	duk_put_prop_string(ctx, -2, "drawLineStrip");
 	duk_push_c_function(ctx, dk_gfxDrawLineLoop, 1);
 	duk_put_prop_string(ctx, -2, "drawLineLoop");
-	duk_push_c_function(ctx, dk_gfxDrawPoints, 2);
+	duk_push_c_function(ctx, dk_gfxDrawPoints, 4);
 	duk_put_prop_string(ctx, -2, "drawPoints");
 	duk_push_c_function(ctx, dk_gfxDrawImage, 6);
 	duk_put_prop_string(ctx, -2, "drawImage");
@@ -546,6 +783,14 @@ void bindGraphics(duk_context *ctx) {
 	duk_put_prop_string(ctx, -2, "drawImages");
 	duk_push_c_function(ctx, dk_gfxDrawSprite, 1);
 	duk_put_prop_string(ctx, -2, "drawSprite");
+	duk_push_c_function(ctx, dk_gfxCreateLayer, 3);
+	duk_put_prop_string(ctx, -2, "createLayer");
+	duk_push_c_function(ctx, dk_gfxDrawLayer, 5);
+	duk_put_prop_string(ctx, -2, "drawLayer");
+	duk_push_c_function(ctx, dk_gfxCreateMesh, 5);
+	duk_put_prop_string(ctx, -2, "createMesh");
+	duk_push_c_function(ctx, dk_gfxDrawMesh, 5);
+	duk_put_prop_string(ctx, -2, "drawMesh");
 
 	const duk_number_list_entry gfx_consts[] = {
 /// @constant {number} gfx.ALIGN_LEFT
@@ -21,6 +21,9 @@
 #include <stddef.h>
 #include <math.h>
 
+#include <SDL_thread.h>
+#include <SDL_cpuinfo.h>
+
 #ifdef __ANDROID__
 #include <SDL_rwops.h>
 #endif
@@ -331,7 +334,7 @@ size_t loadFile(const char* fname, bool isBinary, void** data) {
 	size_t sz = ftell(fp);
 	rewind(fp);
 
-	*data = malloc(sz);
+	*data = malloc(sz + (isBinary ? 0 : 1));
 	size_t szRead = fread(*data, 1, sz, fp);
 	fclose(fp);
 
@@ -346,6 +349,66 @@ size_t loadFile(const char* fname, bool isBinary, void** data) {
 	return sz;
 }
 
+//--- SVG rasterization --------------------------------------------
+
+/// number of threads rasterizing an SVG image, 0 for one per CPU core
+static int svgThreads = 0;
+static const int svgThreadsMax = 8;
+/// images with fewer pixels or bands with fewer rows are not worth another thread
+static const int svgParallelPixelsMin = 256*256, svgBandRowsMin = 32;
+
+/// a horizontal band of an SVG image, rasterized by a rasterizer of its own
+typedef struct {
+	NSVGimage* image;
+	float scale;
+	unsigned char* dst;
+	int w, y0, y1;
+	bool ok;
+} SvgBand;
+
+static int svgBandRasterize(void* udata) {
+	SvgBand* band = (SvgBand*)udata;
+	NSVGrasterizer* rast = nsvgCreateRasterizer();
+	band->ok = rast != NULL;
+	if(rast) {
+		nsvgRasterize(rast, band->image, 0, -band->y0, band->scale,
+			band->dst + (size_t)band->y0*band->w*4, band->w, band->y1-band->y0, band->w*4);
+		nsvgDeleteRasterizer(rast);
+	}
+	return 0;
+}
+
+/// redoes nanosvg's defringing of fully transparent pixels in row y with neighbors of the whole image
+/** Bands only see their own rows, but the result only depends on opaque neighbors, which defringing does not modify. */
+static void svgDefringeRow(unsigned char* img, int w, int h, int y) {
+	const int stride = w*4;
+	unsigned char* row = &img[y*stride];
+	for(int x=0; x<w; ++x, row += 4) {
+		if(row[3])
+			continue;
+		int r = 0, g = 0, b = 0, n = 0;
+		// same neighborhood as nsvg__unpremultiplyAlpha, including its skipping of the first column and row:
+		const unsigned char* nb[4] = { x-1 > 0 ? row-4 : NULL, x+1 < w ? row+4 : NULL,
+			y-1 > 0 ? row-stride : NULL, y+1 < h ? row+stride : NULL };
+		for(int i=0; i<4; ++i)
+			if(nb[i] && nb[i][3]) {
+				r += nb[i][0];
+				g += nb[i][1];
+				b += nb[i][2];
+				++n;
+			}
+		if(n) {
+			row[0] = r/n;
+			row[1] = g/n;
+			row[2] = b/n;
+		}
+	}
+}
+
+void svgRasterThreads(int numThreads) {
+	svgThreads = numThreads;
+}
+
 unsigned char* svgRasterize(char* svg, float scale, int* w, int* h, int* d) {
 	if(!svg || scale <= 0.0f)
 		return 0;
@@ -356,23 +419,48 @@ unsigned char* svgRasterize(char* svg, float scale, int* w, int* h, int* d) {
 		return 0;
 	}
 
-	unsigned char* img = NULL;
-	NSVGrasterizer* rast = nsvgCreateRasterizer();
-	if (rast == NULL)
-		fprintf(stderr, "Could not initialize SVG rasterizer.\n");
-	else {
-		*w = svgParsed->width*scale;
-		*h = svgParsed->height*scale;
-		*d = 4;
+	*w = svgParsed->width*scale;
+	*h = svgParsed->height*scale;
+	*d = 4;
+	unsigned char* img = malloc(*w * *h * *d);
+	if (img == NULL) {
+		fprintf(stderr, "Could not alloc SVG image buffer.\n");
+		nsvgDelete(svgParsed);
+		return NULL;
+	}
 
-		img = malloc(*w * *h * *d);
-		if (img == NULL)
-			fprintf(stderr, "Could not alloc SVG image buffer.\n");
-		else
-			nsvgRasterize(rast, svgParsed, 0,0, scale, img, *w, *h, *w*4);
-		nsvgDeleteRasterizer(rast);
+	// split into horizontal bands rasterized concurrently, the calling thread takes the first one:
+	int numBands = svgThreads>0 ? svgThreads : SDL_GetCPUCount();
+	if(numBands > svgThreadsMax)
+		numBands = svgThreadsMax;
+	if(numBands > *h/svgBandRowsMin)
+		numBands = *h/svgBandRowsMin;
+	if(numBands < 1 || *w * *h < svgParallelPixelsMin)
+		numBands = 1;
+	SvgBand bands[svgThreadsMax];
+	SDL_Thread* threads[svgThreadsMax];
+	for(int i=0; i<numBands; ++i)
+		bands[i] = (SvgBand){ svgParsed, scale, img, *w, *h*i/numBands, *h*(i+1)/numBands, false };
+	for(int i=1; i<numBands; ++i)
+		threads[i] = SDL_CreateThread(svgBandRasterize, "svgRasterize", &bands[i]);
+	svgBandRasterize(&bands[0]);
+	bool ok = bands[0].ok;
+	for(int i=1; i<numBands; ++i) {
+		if(threads[i])
+			SDL_WaitThread(threads[i], NULL);
+		else // no thread available, rasterize it here
+			svgBandRasterize(&bands[i]);
+		ok = ok && bands[i].ok;
 	}
+	for(int i=1; i<numBands; ++i) // rows whose neighborhood crosses a band border
+		for(int y=bands[i].y0-1; y<=bands[i].y0+1 && y<*h; ++y)
+			svgDefringeRow(img, *w, *h, y);
 	nsvgDelete(svgParsed);
+	if(!ok) {
+		fprintf(stderr, "Could not initialize SVG rasterizer.\n");
+		free(img);
+		return NULL;
+	}
 	return img;
 }
 
@@ -400,3 +488,99 @@ uint32_t gfxImageLoad(const char* fname, uint32_t rMask) {
 	return img;
 }
 
+
+//--- skyline rectangle packer -------------------------------------
+
+void skylineInit(SkylinePacker* sp, int w, int h) {
+	sp->w = w;
+	sp->h = h;
+	sp->numNodesMax = 16;
+	sp->nodes = (int*)malloc(sp->numNodesMax*3*sizeof(int));
+	sp->nodes[0] = sp->nodes[1] = 0;
+	sp->nodes[2] = w;
+	sp->numNodes = 1;
+}
+
+void skylineRelease(SkylinePacker* sp) {
+	free(sp->nodes);
+	sp->nodes = NULL;
+	sp->numNodes = sp->numNodesMax = 0;
+}
+
+/// returns the lowest y position of a w*h rectangle starting at node i, or -1 if it does not fit
+static int skylineFit(const SkylinePacker* sp, int i, int w, int h) {
+	if(sp->nodes[i*3] + w > sp->w)
+		return -1;
+	int y = 0;
+	for(int remaining = w; remaining > 0 && i < sp->numNodes; ++i) {
+		const int* node = &sp->nodes[i*3];
+		if(node[1] > y)
+			y = node[1];
+		if(y + h > sp->h)
+			return -1;
+		remaining -= node[2];
+	}
+	return y;
+}
+
+static void skylineRemove(SkylinePacker* sp, int i) {
+	memmove(&sp->nodes[i*3], &sp->nodes[(i+1)*3], (sp->numNodes-i-1)*3*sizeof(int));
+	--sp->numNodes;
+}
+
+bool skylineInsert(SkylinePacker* sp, int w, int h, int* x, int* y) {
+	if(w<=0 || h<=0)
+		return false;
+	int best = -1, bestY = 0, bestTop = sp->h+1, bestW = sp->w+1;
+	for(int i=0; i<sp->numNodes; ++i) {
+		const int top = skylineFit(sp, i, w, h);
+		if(top<0)
+			continue;
+		if(top+h < bestTop || (top+h == bestTop && sp->nodes[i*3+2] < bestW)) {
+			best = i;
+			bestY = top;
+			bestTop = top+h;
+			bestW = sp->nodes[i*3+2];
+		}
+	}
+	if(best<0)
+		return false;
+	*x = sp->nodes[best*3];
+	*y = bestY;
+
+	// insert new segment on top of the allocated rectangle:
+	if(sp->numNodes == sp->numNodesMax) {
+		sp->numNodesMax *= 2;
+		sp->nodes = (int*)realloc(sp->nodes, sp->numNodesMax*3*sizeof(int));
+	}
+	memmove(&sp->nodes[(best+1)*3], &sp->nodes[best*3], (sp->numNodes-best)*3*sizeof(int));
+	++sp->numNodes;
+	sp->nodes[best*3] = *x;
+	sp->nodes[best*3+1] = bestTop;
+	sp->nodes[best*3+2] = w;
+
+	// shrink or remove the segments it covers:
+	for(int i=best+1; i<sp->numNodes; ) {
+		int* node = &sp->nodes[i*3];
+		const int prevEnd = sp->nodes[(i-1)*3] + sp->nodes[(i-1)*3+2];
+		if(node[0] >= prevEnd)
+			break;
+		const int shrink = prevEnd - node[0];
+		node[0] += shrink;
+		node[2] -= shrink;
+		if(node[2] > 0)
+			break;
+		skylineRemove(sp, i);
+	}
+
+	// merge neighboring segments of equal height:
+	for(int i=0; i+1<sp->numNodes; ) {
+		if(sp->nodes[i*3+1] == sp->nodes[(i+1)*3+1]) {
+			sp->nodes[i*3+2] += sp->nodes[(i+1)*3+2];
+			skylineRemove(sp, i+1);
+		}
+		else
+			++i;
+	}
+	return true;
+}
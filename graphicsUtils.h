@@ -35,7 +35,27 @@ extern uint32_t bswap_uint32( uint32_t val );
 
 /// loads a file from file system
 extern size_t loadFile(const char* fname, bool isBinary, void** data);
+/// parses and rasterizes an SVG image into RGBA pixels, to be freed by the caller
+/** Larger images are split into horizontal bands rasterized concurrently. svg is modified by parsing. */
 extern unsigned char* svgRasterize(char* svg, float scale, int* w, int* h, int* d);
+/// sets the number of threads rasterizing an SVG image, values <=0 mean one per CPU core
+extern void svgRasterThreads(int numThreads);
 extern unsigned char* readImageData(const unsigned char* buf, size_t bufsz, int* w, int* h, int* d);
 /// convenience function loading an image file from file system and uploading it to graphics memory in a single call
 extern uint32_t gfxImageLoad(const char* fname, uint32_t rMask);
+
+/// rectangle packer based on the skyline bottom-left heuristic
+typedef struct {
+	int w, h;
+	/// skyline segments as x,y,width triples ordered by x
+	int* nodes;
+	int numNodes, numNodesMax;
+} SkylinePacker;
+
+/// initializes a packer for an empty area of w*h
+extern void skylineInit(SkylinePacker* sp, int w, int h);
+/// releases memory allocated by a packer
+extern void skylineRelease(SkylinePacker* sp);
+/// allocates a w*h rectangle and returns its position in x,y
+/** \return false if the rectangle does not fit anymore */
+extern bool skylineInsert(SkylinePacker* sp, int w, int h, int* x, int* y);
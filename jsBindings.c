@@ -7,6 +7,7 @@
 #include "audio.h"
 #include "graphics.h"
 #include "console.h"
+#include "profiler.h"
 #include "httpRequest.h"
 #include "log.h"
 
@@ -758,6 +759,94 @@ static duk_ret_t dk_getResource(duk_context *ctx) {
 	return 1;
 }
 
+/// tag of the latest asynchronous image request, identifying it in asyncResources
+static uint32_t asyncResourceTag = 0;
+/// seconds per frame spent on uploading asynchronously decoded images
+static const double asyncUploadBudget = 0.004;
+
+static void asyncResourceComplete(duk_context *ctx, duk_idx_t req);
+
+/**
+ * @function app.getResourceAsync
+ * loads image resources in the background, reading and decoding them by a pool of loader threads
+ *
+ * Decoded images are uploaded to graphics memory within a small time budget per frame. Other resource
+ * types are loaded immediately, as by app.getResource. The callback is called once all resources are
+ * available, immediately if the request does not contain any image resources.
+ * @param {string|array} name - resource file name or list of resource file names
+ * @param {object} [params] - optional additional parameters as key-value pairs such as
+ *   filtering and centerX, centerY for images, scale for SVG images, or size for font resources
+ * @param {function} [callback] - function receiving the resource handle or array of handles, 0 for images that failed to load
+ */
+static duk_ret_t dk_getResourceAsync(duk_context *ctx) {
+	const bool isArray = duk_is_array(ctx, 0);
+	const uint32_t len = isArray ? duk_get_length(ctx, 0) : 1;
+	int filtering = 1;
+	float scale = 1.0, cx = 0.0f, cy = 0.0f;
+	readImageResourceParams(ctx, 1, &scale, &filtering, &cx, &cy);
+
+	// the request object collects the results of all resources:
+	duk_idx_t req = duk_push_object(ctx);
+	if(duk_is_function(ctx, 2)) {
+		duk_dup(ctx, 2);
+		duk_put_prop_literal(ctx, req, "callback");
+	}
+	duk_push_boolean(ctx, isArray);
+	duk_put_prop_literal(ctx, req, "isArray");
+	duk_push_number(ctx, cx);
+	duk_put_prop_literal(ctx, req, "centerX");
+	duk_push_number(ctx, cy);
+	duk_put_prop_literal(ctx, req, "centerY");
+	duk_idx_t handles = duk_push_array(ctx);
+	duk_get_global_literal(ctx, DUK_HIDDEN_SYMBOL("asyncResources"));
+	duk_idx_t pending = duk_get_top_index(ctx);
+
+	uint32_t remaining = 0;
+	for(uint32_t idx=0; idx<len; ++idx) {
+		if(isArray)
+			duk_get_prop_index(ctx, 0, idx);
+		else
+			duk_dup(ctx, 0);
+		const char* name = duk_to_string(ctx, -1);
+		if(ResourceType(name) == RESOURCE_IMAGE) {
+			if(!++asyncResourceTag)
+				++asyncResourceTag;
+			if(!ResourceGetImageAsync(name, scale, filtering, asyncResourceTag)) {
+				// cancel the images already queued by this request, their loads are ignored:
+				for(uint32_t tag = asyncResourceTag; remaining; --remaining) {
+					if(!--tag)
+						--tag;
+					duk_del_prop_index(ctx, pending, tag);
+				}
+				snprintf(s_lastError, ERROR_MAXLEN, "app.getResourceAsync(\"%s\") failed\n", name);
+				return duk_error(ctx, DUK_ERR_REFERENCE_ERROR, s_lastError);
+			}
+			duk_pop(ctx);
+			// pending images refer to their request and their index within it:
+			duk_push_array(ctx);
+			duk_dup(ctx, req);
+			duk_put_prop_index(ctx, -2, 0);
+			duk_push_uint(ctx, idx);
+			duk_put_prop_index(ctx, -2, 1);
+			duk_put_prop_index(ctx, pending, asyncResourceTag);
+			duk_push_uint(ctx, 0);
+			++remaining;
+		}
+		else {
+			dk_getNamedResource(name, ctx);
+			duk_remove(ctx, -2);
+		}
+		duk_put_prop_index(ctx, handles, idx);
+	}
+	duk_pop(ctx); // asyncResources
+	duk_put_prop_literal(ctx, req, "handles");
+	duk_push_uint(ctx, remaining);
+	duk_put_prop_literal(ctx, req, "remaining");
+	if(!remaining)
+		asyncResourceComplete(ctx, req);
+	return 0;
+}
+
 /**
  * @function app.createCircleResource
  * creates a circle image resource
@@ -1015,9 +1104,9 @@ static duk_ret_t dk_createImageResource(duk_context *ctx) {
 
 /**
  * @function app.releaseResource
- * releases a previously uploaded image, audio, or font resource
+ * releases a previously uploaded image, audio, font, or mesh resource
  * @param {number} handle - resource handle
- * @param {string} mediaType - mediaType, either 'image', 'audio', or 'font'
+ * @param {string} mediaType - mediaType, either 'image', 'audio', 'font', or 'mesh'
  */
 static duk_ret_t dk_releaseResource(duk_context *ctx) {
 	uint32_t handle = duk_to_uint32(ctx, 0);
@@ -1028,6 +1117,8 @@ static duk_ret_t dk_releaseResource(duk_context *ctx) {
 		gfxFontRelease(handle);
 	else if(strncmp(mediaType, "audio", 5)==0)
 		AudioRelease(handle);
+	else if(strncmp(mediaType, "mesh", 4)==0)
+		gfxMeshRelease(handle);
 	return 0;
 }
 
@@ -1120,6 +1211,45 @@ static duk_ret_t dk_appMinimize(duk_context *ctx) {
 	return 0;
 }
 
+/**
+ * @function app.stats
+ * returns per-frame profiling statistics over the most recent frames. Each metric is an object
+ * {last, avg, max}: timings of the main loop phases listeners, async, update, draw, present, events,
+ * and frame in milliseconds, counters drawCalls, textureSwitches, and vertices of submitted geometry,
+ * audio mixing time in milliseconds, script heap allocations jsAllocs and size jsHeap in KiB,
+ * deadlineMiss, the milliseconds a frame missed its max_fps deadline, and pipelineStalls, the number
+ * of mid-frame operations that waited for the render thread of pipelined rendering.
+ * @returns {object} metrics by name, and the number of frames they cover as frames
+ */
+static duk_ret_t dk_appStats(duk_context *ctx) {
+	duk_push_object(ctx);
+	duk_push_uint(ctx, ProfilerNumFrames());
+	duk_put_prop_literal(ctx, -2, "frames");
+	for(int i=0; i<PROF_NUM_METRICS; ++i) {
+		ProfilerStat stat;
+		ProfilerStats(i, &stat);
+		duk_push_object(ctx);
+		duk_push_number(ctx, stat.last);
+		duk_put_prop_literal(ctx, -2, "last");
+		duk_push_number(ctx, stat.avg);
+		duk_put_prop_literal(ctx, -2, "avg");
+		duk_push_number(ctx, stat.max);
+		duk_put_prop_literal(ctx, -2, "max");
+		duk_put_prop_string(ctx, -2, ProfilerName(i));
+	}
+	return 1;
+}
+
+/**
+ * @function app.showStats
+ * shows or hides an on-screen overlay of the statistics returned by app.stats()
+ * @param {bool} visible
+ */
+static duk_ret_t dk_appShowStats(duk_context *ctx) {
+	ConsoleStatsVisible(duk_to_boolean(ctx, 0));
+	return 0;
+}
+
 /**
  * @function app.transformArray
  * transforms a Float32Array by applying a function on all groups of members
@@ -1696,6 +1826,8 @@ static void bindApp(duk_context *ctx, const Value* args) {
 	duk_put_prop_string(ctx, -2, "emit");
 	duk_push_c_function(ctx, dk_getResource, 3);
 	duk_put_prop_string(ctx, -2, "getResource");
+	duk_push_c_function(ctx, dk_getResourceAsync, 3);
+	duk_put_prop_string(ctx, -2, "getResourceAsync");
 	duk_push_c_function(ctx, dk_createCircleResource, DUK_VARARGS);
 	duk_put_prop_string(ctx, -2, "createCircleResource");
 	duk_push_c_function(ctx, dk_createPathResource, DUK_VARARGS);
@@ -1739,6 +1871,10 @@ static void bindApp(duk_context *ctx, const Value* args) {
 	duk_put_prop_string(ctx, -2, "fullscreen");
 	duk_push_c_function(ctx, dk_appMinimize, 1);
 	duk_put_prop_string(ctx, -2, "minimize");
+	duk_push_c_function(ctx, dk_appStats, 0);
+	duk_put_prop_string(ctx, -2, "stats");
+	duk_push_c_function(ctx, dk_appShowStats, 1);
+	duk_put_prop_string(ctx, -2, "showStats");
 	duk_push_c_function(ctx, dk_transformArray, DUK_VARARGS);
 	duk_put_prop_string(ctx, -2, "transformArray");
 	duk_push_c_function(ctx, dk_appSetPointer, 1);
@@ -1793,6 +1929,8 @@ static void bindApp(duk_context *ctx, const Value* args) {
 
 	duk_push_object(ctx);
 	duk_put_global_string(ctx, DUK_HIDDEN_SYMBOL("httpCallbacks"));
+	duk_push_object(ctx);
+	duk_put_global_string(ctx, DUK_HIDDEN_SYMBOL("asyncResources"));
 
 	memset(httpRequests, 0, sizeof(HttpRequest)*httpRequestsMax);
 }
@@ -2518,11 +2656,71 @@ static void modulesUnload() {
 	numModules = 0;
 }
 
+//--- heap accounting ----------------------------------------------
+
+/// size prefix of script heap allocations, aligned for any type
+typedef union {
+	size_t size;
+	long double align;
+	void* alignPtr;
+} HeapBlock;
+
+/// live bytes and allocations since the last jsvmHeapCounters() call of the script heap
+static size_t heapBytes = 0;
+static uint32_t heapAllocs = 0;
+
+static void* heapAlloc(void* udata, duk_size_t size) {
+	(void)udata;
+	HeapBlock* block = size ? (HeapBlock*)malloc(sizeof(HeapBlock)+size) : NULL;
+	if(!block)
+		return NULL;
+	block->size = size;
+	heapBytes += size;
+	++heapAllocs;
+	return block+1;
+}
+
+static void heapFree(void* udata, void* ptr) {
+	(void)udata;
+	if(!ptr)
+		return;
+	HeapBlock* block = (HeapBlock*)ptr - 1;
+	heapBytes -= block->size;
+	free(block);
+}
+
+static void* heapRealloc(void* udata, void* ptr, duk_size_t size) {
+	if(!ptr)
+		return heapAlloc(udata, size);
+	if(!size) {
+		heapFree(udata, ptr);
+		return NULL;
+	}
+	HeapBlock* block = (HeapBlock*)ptr - 1;
+	const size_t prevSize = block->size;
+	block = (HeapBlock*)realloc(block, sizeof(HeapBlock)+size);
+	if(!block)
+		return NULL;
+	block->size = size;
+	heapBytes = heapBytes - prevSize + size;
+	++heapAllocs;
+	return block+1;
+}
+
+void jsvmHeapCounters(size_t vm, size_t* numBytes, uint32_t* numAllocs) {
+	(void)vm;
+	if(numBytes)
+		*numBytes = heapBytes;
+	if(numAllocs)
+		*numAllocs = heapAllocs;
+	heapAllocs = 0;
+}
+
 //--- public interface ---------------------------------------------
 
 size_t jsvmInit(const char* storageFileName, const Value* args) {
 	s_lastError[0] = 0;
-	duk_context *ctx = duk_create_heap_default();
+	duk_context *ctx = duk_create_heap(heapAlloc, heapRealloc, heapFree, NULL, NULL);
 	if(!ctx)
 		return 0;
 
@@ -2692,8 +2890,61 @@ void jsvmUpdateEventListeners(size_t vm) {
 	duk_pop(ctx);
 }
 
+/// calls the callback of an app.getResourceAsync request object at index req
+static void asyncResourceComplete(duk_context *ctx, duk_idx_t req) {
+	if(!duk_get_prop_literal(ctx, req, "callback") || !duk_is_function(ctx, -1)) {
+		duk_pop(ctx);
+		return;
+	}
+	duk_get_prop_literal(ctx, req, "handles");
+	duk_get_prop_literal(ctx, req, "isArray");
+	if(!duk_to_boolean(ctx, -1)) {
+		duk_pop(ctx);
+		duk_get_prop_index(ctx, -1, 0);
+		duk_remove(ctx, -2);
+	}
+	else
+		duk_pop(ctx);
+	callEventHandler(ctx, "getResourceAsync", false, 1);
+	duk_pop(ctx); // ignore cb return value
+}
+
+/// stores the handle of an asynchronously loaded image in its request, completing the request with its last image
+static void asyncResourceLoaded(void* udata, uint32_t tag, size_t handle) {
+	duk_context *ctx = (duk_context*)udata;
+	duk_get_global_literal(ctx, DUK_HIDDEN_SYMBOL("asyncResources"));
+	if(!duk_get_prop_index(ctx, -1, tag)) {
+		duk_pop_2(ctx);
+		return;
+	}
+	duk_del_prop_index(ctx, -2, tag);
+	duk_get_prop_index(ctx, -1, 0);
+	duk_idx_t req = duk_get_top_index(ctx);
+	duk_get_prop_index(ctx, -2, 1);
+	const uint32_t idx = duk_to_uint32(ctx, -1);
+	duk_pop(ctx);
+
+	if(handle)
+		gfxImageSetCenter(handle, getPropFloatDefault(ctx, req, "centerX", 0.0f),
+			getPropFloatDefault(ctx, req, "centerY", 0.0f));
+	duk_get_prop_literal(ctx, req, "handles");
+	duk_push_number(ctx, (double)handle);
+	duk_put_prop_index(ctx, -2, idx);
+	duk_pop(ctx);
+
+	duk_get_prop_literal(ctx, req, "remaining");
+	const uint32_t remaining = duk_to_uint32(ctx, -1) - 1;
+	duk_pop(ctx);
+	duk_push_uint(ctx, remaining);
+	duk_put_prop_literal(ctx, req, "remaining");
+	if(!remaining)
+		asyncResourceComplete(ctx, req);
+	duk_pop_3(ctx);
+}
+
 void jsvmAsyncCalls(size_t vm, double timestamp) {
 	duk_context *ctx = (duk_context*)vm;
+	ResourceAsyncUpdate(asyncUploadBudget, asyncResourceLoaded, ctx);
 	for(int i=0; i<httpRequestsMax; ++i) {
 		if(httpRequests[i].status!=0 && httpRequests[i].status!=103) {
 			HttpRequest* req = &httpRequests[i];
@@ -2876,7 +3127,7 @@ double jsonGetNumber(size_t json, const char* key, double defaultValue) {
 	duk_context *ctx = (duk_context*)json;
 	if(!ctx)
 		return defaultValue;
-	double f = (duk_get_prop_string(ctx, -1, key) && duk_is_number(ctx, -1)) ?
+	double f = (duk_get_prop_string(ctx, -1, key) && (duk_is_number(ctx, -1) || duk_is_boolean(ctx, -1))) ?
 		duk_to_number(ctx, -1) : defaultValue;
 	duk_pop(ctx);
 	return f;
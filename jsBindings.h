@@ -13,6 +13,8 @@ extern void jsvmDispatchDrawEvent(size_t vm);
 extern void jsvmUpdateEventListeners(size_t vm);
 extern void jsvmAsyncCalls(size_t vm, double timestamp);
 extern const char* jsvmLastError(size_t vm);
+/// returns the script heap's live bytes and its number of (re)allocations since the previous call
+extern void jsvmHeapCounters(size_t vm, size_t* numBytes, uint32_t* numAllocs);
 /// imports javascript bindings from a shared dynamic library
 extern int jsvmRequire(size_t vm, const char* dllName);
 
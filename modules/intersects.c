@@ -1,4 +1,5 @@
 #include "intersects.h"
+#include "../transf2d.h"
 #include <float.h>
 #include <math.h>
 #include <stdlib.h>
@@ -6,18 +7,15 @@
 
 void intersectsTransf(float x, float y, float rot, uint32_t arrSz, float* arr) {
 	float cosine = cos(rot), sine = sin(rot);
-	for(uint32_t i=0; i+1<arrSz; i+=2) {
-		float ax=arr[i], ay=arr[i+1];
-		arr[i] = ax*cosine - ay*sine + x, arr[i+1] = ax*sine + ay*cosine + y;
-	}
+	const float transf[] = { cosine, -sine, x, sine, cosine, y };
+	transf2d(transf, arrSz, arr, arr);
 }
 
 void intersectsTransfInv(float x, float y, float rot, uint32_t arrSz, float* arr) {
 	float cosine = cos(-rot), sine = sin(-rot);
-	for(uint32_t i=0; i+1<arrSz; i+=2) {
-		float ax=arr[i]-x, ay=arr[i+1]-y;
-		arr[i] = ax*cosine - ay*sine, arr[i+1] = ax*sine + ay*cosine;
-	}
+	// rotation of the translated coordinates, folded into a single affine matrix:
+	const float transf[] = { cosine, -sine, -x*cosine + y*sine, sine, cosine, -x*sine - y*cosine };
+	transf2d(transf, arrSz, arr, arr);
 }
 
 int intersectsPointCircle(float x, float y, float cx, float cy, float r) {
@@ -0,0 +1,77 @@
+#include "profiler.h"
+
+#include <string.h>
+#include <SDL_timer.h>
+
+/// number of most recent frames statistics are computed over
+#define PROF_WINDOW 120
+
+static const char* profNames[PROF_NUM_METRICS] = {
+	"listeners", "async", "update", "draw", "present", "events", "frame",
+	"drawCalls", "textureSwitches", "vertices", "audio", "jsAllocs", "jsHeap", "deadlineMiss",
+	"pipelineStalls" };
+static const char* profUnits[PROF_NUM_METRICS] = {
+	"ms", "ms", "ms", "ms", "ms", "ms", "ms",
+	"", "", "", "ms", "", "KiB", "ms", "" };
+
+/// ring buffer of completed frames per metric
+static float profSamples[PROF_NUM_METRICS][PROF_WINDOW];
+/// metrics of the frame in progress
+static float profCurrent[PROF_NUM_METRICS];
+static uint32_t profFrames = 0;
+static uint64_t profTick = 0, profFrameTick = 0;
+static double profTickMs = 0.0;
+
+void ProfilerFrameStart() {
+	if(profTickMs == 0.0)
+		profTickMs = 1000.0/(double)SDL_GetPerformanceFrequency();
+	memset(profCurrent, 0, sizeof(profCurrent));
+	profTick = profFrameTick = SDL_GetPerformanceCounter();
+}
+
+void ProfilerPhase(ProfilerMetric phase) {
+	const uint64_t tick = SDL_GetPerformanceCounter();
+	if(phase < PROF_FRAME)
+		profCurrent[phase] += (tick-profTick)*profTickMs;
+	profTick = tick;
+}
+
+void ProfilerCount(ProfilerMetric counter, float value) {
+	if(counter < PROF_NUM_METRICS)
+		profCurrent[counter] = value;
+}
+
+void ProfilerFrameEnd() {
+	profCurrent[PROF_FRAME] = (profTick-profFrameTick)*profTickMs;
+	const uint32_t slot = profFrames++ % PROF_WINDOW;
+	for(int i=0; i<PROF_NUM_METRICS; ++i)
+		profSamples[i][slot] = profCurrent[i];
+}
+
+void ProfilerStats(ProfilerMetric metric, ProfilerStat* stat) {
+	memset(stat, 0, sizeof(ProfilerStat));
+	const uint32_t n = ProfilerNumFrames();
+	if(metric >= PROF_NUM_METRICS || !n)
+		return;
+	const float* samples = profSamples[metric];
+	double sum = 0.0;
+	for(uint32_t i=0; i<n; ++i) {
+		sum += samples[i];
+		if(samples[i] > stat->max)
+			stat->max = samples[i];
+	}
+	stat->avg = sum/n;
+	stat->last = samples[(profFrames-1) % PROF_WINDOW];
+}
+
+uint32_t ProfilerNumFrames() {
+	return profFrames < PROF_WINDOW ? profFrames : PROF_WINDOW;
+}
+
+const char* ProfilerName(ProfilerMetric metric) {
+	return metric < PROF_NUM_METRICS ? profNames[metric] : "";
+}
+
+const char* ProfilerUnit(ProfilerMetric metric) {
+	return metric < PROF_NUM_METRICS ? profUnits[metric] : "";
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+
+//--- per-frame profiler -------------------------------------------
+/** Times the phases of the main loop and collects per-frame counters, keeping a rolling
+ * window of the most recent frames for averages and worst-case values. */
+
+/// profiled metrics, the timed main loop phases come first in execution order
+typedef enum {
+	PROF_LISTENERS = 0,
+	PROF_ASYNC,
+	PROF_UPDATE,
+	PROF_DRAW,
+	PROF_PRESENT,
+	PROF_EVENTS,
+	/// sum of all phases
+	PROF_FRAME,
+	/// counters of the frame, set via ProfilerCount()
+	PROF_DRAW_CALLS,
+	PROF_TEXTURE_SWITCHES,
+	PROF_VERTICES,
+	PROF_AUDIO,
+	PROF_JS_ALLOCS,
+	PROF_JS_HEAP,
+	PROF_DEADLINE_MISS,
+	PROF_PIPELINE_STALLS,
+	PROF_NUM_METRICS
+} ProfilerMetric;
+
+#define PROF_NUM_PHASES (PROF_FRAME+1)
+
+/// statistics of a metric over the rolling window
+typedef struct {
+	float last, avg, max;
+} ProfilerStat;
+
+/// starts timing a new frame
+extern void ProfilerFrameStart();
+/// adds the time elapsed since the end of the previous phase or the frame start to phase
+extern void ProfilerPhase(ProfilerMetric phase);
+/// sets a counter of the current frame
+extern void ProfilerCount(ProfilerMetric counter, float value);
+/// completes the current frame and moves it into the rolling window
+extern void ProfilerFrameEnd();
+/// returns last, average, and maximum value of a metric over the rolling window
+extern void ProfilerStats(ProfilerMetric metric, ProfilerStat* stat);
+/// returns the number of frames in the rolling window
+extern uint32_t ProfilerNumFrames();
+/// returns a metric's name in camel case, as used by app.stats()
+extern const char* ProfilerName(ProfilerMetric metric);
+/// returns a metric's unit, an empty string for plain counts
+extern const char* ProfilerUnit(ProfilerMetric metric);
@@ -0,0 +1,737 @@
+#include "raster.h"
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#  define RASTER_HAS_SSE2
+#  include <emmintrin.h>
+#endif
+
+#define RASTER_TILE_SIZE 64
+
+struct RasterTexture {
+	uint32_t* px;
+	int w, h;
+	int blendMode;
+	void* userData;
+};
+
+/// a triangle prepared for rasterization, all equations refer to pixel centers
+typedef struct {
+	/// barycentric edge equations a*x + b*y + c, one per vertex
+	float edge[3][3];
+	/// attribute plane equations d/dx, d/dy, value at 0|0 for u, v in texels, and r, g, b, a
+	float plane[6][3];
+	/// screen space bounding box x0,y0,x1,y1, x1 and y1 exclusive, already clipped
+	int bbox[4];
+	RasterTexture* tex;
+	int blendMode;
+	/// uniform color, only valid if isFlat
+	uint8_t clr[4];
+	bool isFlat;
+	/// per edge flag whether pixels exactly on the edge belong to the triangle
+	bool topLeft[3];
+} RasterTri;
+
+typedef struct {
+	uint32_t* tris;
+	uint32_t num, numMax;
+} RasterBin;
+
+typedef void (*RasterBlendFunc)(uint32_t* dst, const uint32_t* src, int n);
+
+static struct {
+	SDL_Renderer* renderer;
+	SDL_Texture* screenTex;
+	RasterTexture screen;
+	/// completed screen framebuffer awaiting presentation, of the same size as screen
+	uint32_t* presentPx;
+	RasterTexture* target;
+	/// clip rectangle x0,y0,x1,y1 of the current target and the saved one of the screen
+	int clip[4], screenClip[4];
+	bool clipEnabled, screenClipEnabled;
+
+	RasterTri* tris;
+	uint32_t numTris, numTrisMax;
+	RasterBin* bins;
+	uint32_t numBinsMax;
+	int tilesX, tilesY;
+	/// indices of tiles having at least one triangle
+	uint32_t* activeTiles;
+	uint32_t numActiveTiles, numActiveTilesMax;
+
+	SDL_Thread** threads;
+	int numWorkers;
+	SDL_sem *start, *done;
+	SDL_atomic_t nextTile;
+	volatile bool quit;
+	/// per thread span buffers of RASTER_TILE_SIZE source pixels
+	uint32_t* spans;
+	RasterBlendFunc blendAlpha;
+} rst;
+
+//--- blending -----------------------------------------------------
+
+/// divides by 255 with correct rounding for 0 <= v <= 65025
+static inline uint32_t div255(uint32_t v) {
+	v += 128;
+	return (v + (v>>8)) >> 8;
+}
+
+static void blendAlphaScalar(uint32_t* dst, const uint32_t* src, int n) {
+	for(int i=0; i<n; ++i) {
+		const uint8_t* s = (const uint8_t*)&src[i];
+		const uint32_t a = s[3];
+		if(a==255)
+			dst[i] = src[i];
+		else if(a) {
+			uint8_t* d = (uint8_t*)&dst[i];
+			const uint32_t ia = 255-a;
+			d[0] = div255(s[0]*a + d[0]*ia);
+			d[1] = div255(s[1]*a + d[1]*ia);
+			d[2] = div255(s[2]*a + d[2]*ia);
+			d[3] = div255(255*a + d[3]*ia);
+		}
+	}
+}
+
+#ifdef RASTER_HAS_SSE2
+/// computes the same results as blendAlphaScalar for four pixels per iteration
+static void blendAlphaSSE2(uint32_t* dst, const uint32_t* src, int n) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i maskRGB = _mm_setr_epi16(-1,-1,-1,0, -1,-1,-1,0);
+	const __m128i alpha255 = _mm_setr_epi16(0,0,0,255, 0,0,0,255);
+	const __m128i c255 = _mm_set1_epi16(255), c128 = _mm_set1_epi16(128);
+	int i=0;
+	for(; i+4<=n; i+=4) {
+		const __m128i s = _mm_loadu_si128((const __m128i*)&src[i]);
+		const __m128i d = _mm_loadu_si128((const __m128i*)&dst[i]);
+		__m128i lo, hi;
+		for(int half=0; half<2; ++half) {
+			__m128i sh = half ? _mm_unpackhi_epi8(s, zero) : _mm_unpacklo_epi8(s, zero);
+			const __m128i dh = half ? _mm_unpackhi_epi8(d, zero) : _mm_unpacklo_epi8(d, zero);
+			const __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(sh, 0xff), 0xff);
+			sh = _mm_or_si128(_mm_and_si128(sh, maskRGB), alpha255);
+			__m128i v = _mm_add_epi16(_mm_mullo_epi16(sh, a), _mm_mullo_epi16(dh, _mm_sub_epi16(c255, a)));
+			v = _mm_add_epi16(v, c128);
+			v = _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), 8);
+			if(half)
+				hi = v;
+			else
+				lo = v;
+		}
+		_mm_storeu_si128((__m128i*)&dst[i], _mm_packus_epi16(lo, hi));
+	}
+	blendAlphaScalar(&dst[i], &src[i], n-i);
+}
+#endif
+
+static void blendAdd(uint32_t* dst, const uint32_t* src, int n) {
+	for(int i=0; i<n; ++i) {
+		const uint8_t* s = (const uint8_t*)&src[i];
+		uint8_t* d = (uint8_t*)&dst[i];
+		const uint32_t a = s[3];
+		for(int c=0; c<3; ++c) {
+			const uint32_t v = d[c] + div255(s[c]*a);
+			d[c] = v>255 ? 255 : v;
+		}
+	}
+}
+
+static void blendMod(uint32_t* dst, const uint32_t* src, int n) {
+	for(int i=0; i<n; ++i) {
+		const uint8_t* s = (const uint8_t*)&src[i];
+		uint8_t* d = (uint8_t*)&dst[i];
+		for(int c=0; c<3; ++c)
+			d[c] = div255(s[c]*d[c]);
+	}
+}
+
+static void blendMul(uint32_t* dst, const uint32_t* src, int n) {
+	for(int i=0; i<n; ++i) {
+		const uint8_t* s = (const uint8_t*)&src[i];
+		uint8_t* d = (uint8_t*)&dst[i];
+		const uint32_t ia = 255-s[3];
+		for(int c=0; c<3; ++c) {
+			const uint32_t v = div255(s[c]*d[c]) + div255(d[c]*ia);
+			d[c] = v>255 ? 255 : v;
+		}
+	}
+}
+
+static void blendNone(uint32_t* dst, const uint32_t* src, int n) {
+	memcpy(dst, src, n*sizeof(uint32_t));
+}
+
+static RasterBlendFunc blendFunc(int blendMode) {
+	switch(blendMode) {
+	case RASTER_BLEND_ALPHA: return rst.blendAlpha;
+	case RASTER_BLEND_ADD: return blendAdd;
+	case RASTER_BLEND_MOD: return blendMod;
+	case RASTER_BLEND_MUL: return blendMul;
+	default: return blendNone;
+	}
+}
+
+//--- shading ------------------------------------------------------
+
+static inline uint32_t packRGBA(int r, int g, int b, int a) {
+	uint32_t px;
+	uint8_t* p = (uint8_t*)&px;
+	p[0] = r<0 ? 0 : r>255 ? 255 : r;
+	p[1] = g<0 ? 0 : g>255 ? 255 : g;
+	p[2] = b<0 ? 0 : b>255 ? 255 : b;
+	p[3] = a<0 ? 0 : a>255 ? 255 : a;
+	return px;
+}
+
+/// bilinearly filtered texel at u|v in texel space, clamped to the texture's edges
+static inline uint32_t sampleBilinear(const RasterTexture* tex, float u, float v) {
+	// fixed point with 8 fractional bits, rounding absorbs interpolation errors of exactly aligned texels:
+	const int fu = (int)floorf(u*256.0f + 0.5f), fv = (int)floorf(v*256.0f + 0.5f);
+	int x0 = fu >> 8, y0 = fv >> 8;
+	const uint32_t wu = fu & 0xff, wv = fv & 0xff;
+	int x1 = x0+1, y1 = y0+1;
+	x0 = x0<0 ? 0 : x0>=tex->w ? tex->w-1 : x0;
+	x1 = x1<0 ? 0 : x1>=tex->w ? tex->w-1 : x1;
+	y0 = y0<0 ? 0 : y0>=tex->h ? tex->h-1 : y0;
+	y1 = y1<0 ? 0 : y1>=tex->h ? tex->h-1 : y1;
+	const uint32_t* row0 = &tex->px[y0*tex->w], *row1 = &tex->px[y1*tex->w];
+	if(!wu && !wv)
+		return row0[x0];
+	const uint32_t w11 = (wu*wv)>>8, w10 = ((wu<<8) - wu*wv)>>8, w01 = ((wv<<8) - wu*wv)>>8;
+	const uint32_t w00 = 256 - w10 - w01 - w11;
+	const uint32_t p00 = row0[x0], p10 = row0[x1], p01 = row1[x0], p11 = row1[x1];
+	// two channels per 32bit word, each weighted sum stays below 1<<16:
+	const uint32_t rb = ((p00 & 0xff00ff)*w00 + (p10 & 0xff00ff)*w10
+		+ (p01 & 0xff00ff)*w01 + (p11 & 0xff00ff)*w11) >> 8;
+	const uint32_t ga = (((p00>>8) & 0xff00ff)*w00 + ((p10>>8) & 0xff00ff)*w10
+		+ ((p01>>8) & 0xff00ff)*w01 + ((p11>>8) & 0xff00ff)*w11) >> 8;
+	return (rb & 0xff00ff) | ((ga & 0xff00ff)<<8);
+}
+
+static inline uint32_t modulate(uint32_t texel, const uint8_t* clr) {
+	uint8_t* p = (uint8_t*)&texel;
+	p[0] = div255(p[0]*clr[0]);
+	p[1] = div255(p[1]*clr[1]);
+	p[2] = div255(p[2]*clr[2]);
+	p[3] = div255(p[3]*clr[3]);
+	return texel;
+}
+
+/// rasterizes the part of a triangle inside a tile, span is a buffer of RASTER_TILE_SIZE pixels
+static void rasterTriTile(const RasterTri* t, const int* tile, uint32_t* span) {
+	const int x0 = t->bbox[0] > tile[0] ? t->bbox[0] : tile[0];
+	const int y0 = t->bbox[1] > tile[1] ? t->bbox[1] : tile[1];
+	const int x1 = t->bbox[2] < tile[2] ? t->bbox[2] : tile[2];
+	const int y1 = t->bbox[3] < tile[3] ? t->bbox[3] : tile[3];
+	if(x0>=x1 || y0>=y1)
+		return;
+	RasterTexture* target = rst.target ? rst.target : &rst.screen;
+	const RasterBlendFunc blend = blendFunc(t->blendMode);
+	const uint32_t flatClr = packRGBA(t->clr[0], t->clr[1], t->clr[2], t->clr[3]);
+	const bool isWhite = t->isFlat && flatClr==0xffffffff;
+	const float (*e)[3] = t->edge;
+
+	for(int y=y0; y<y1; ++y) {
+		const float py = y+0.5f, px0 = x0+0.5f;
+		float l[3];
+		for(int i=0; i<3; ++i)
+			l[i] = e[i][0]*px0 + e[i][1]*py + e[i][2];
+		// determine the covered span, which is contiguous due to convexity:
+		int xs = -1, xe = x1;
+		for(int x=x0; x<x1; ++x) {
+			bool inside = true;
+			for(int i=0; i<3 && inside; ++i)
+				inside = l[i]>0.0f || (l[i]==0.0f && t->topLeft[i]);
+			if(inside && xs<0)
+				xs = x;
+			else if(!inside && xs>=0) {
+				xe = x;
+				break;
+			}
+			l[0] += e[0][0]; l[1] += e[1][0]; l[2] += e[2][0];
+		}
+		if(xs<0)
+			continue;
+
+		const int n = xe-xs;
+		const float sx = xs+0.5f;
+		if(!t->tex) {
+			if(t->isFlat)
+				for(int i=0; i<n; ++i)
+					span[i] = flatClr;
+			else {
+				const float (*p)[3] = &t->plane[2];
+				for(int i=0; i<n; ++i) {
+					const float x = sx+i;
+					span[i] = packRGBA(
+						(int)(p[0][0]*x + p[0][1]*py + p[0][2] + 0.5f), (int)(p[1][0]*x + p[1][1]*py + p[1][2] + 0.5f),
+						(int)(p[2][0]*x + p[2][1]*py + p[2][2] + 0.5f), (int)(p[3][0]*x + p[3][1]*py + p[3][2] + 0.5f));
+				}
+			}
+		}
+		else {
+			const float (*p)[3] = t->plane;
+			float u = p[0][0]*sx + p[0][1]*py + p[0][2], v = p[1][0]*sx + p[1][1]*py + p[1][2];
+			for(int i=0; i<n; ++i, u += p[0][0], v += p[1][0]) {
+				const uint32_t texel = sampleBilinear(t->tex, u, v);
+				if(isWhite)
+					span[i] = texel;
+				else if(t->isFlat)
+					span[i] = modulate(texel, t->clr);
+				else {
+					const float x = sx+i;
+					const uint32_t c = packRGBA(
+						(int)(p[2][0]*x + p[2][1]*py + p[2][2] + 0.5f), (int)(p[3][0]*x + p[3][1]*py + p[3][2] + 0.5f),
+						(int)(p[4][0]*x + p[4][1]*py + p[4][2] + 0.5f), (int)(p[5][0]*x + p[5][1]*py + p[5][2] + 0.5f));
+					span[i] = modulate(texel, (const uint8_t*)&c);
+				}
+			}
+		}
+		blend(&target->px[y*target->w + xs], span, n);
+	}
+}
+
+//--- tile scheduling ----------------------------------------------
+
+static void rasterTiles(uint32_t* span) {
+	const int w = rst.target ? rst.target->w : rst.screen.w, h = rst.target ? rst.target->h : rst.screen.h;
+	for(;;) {
+		const uint32_t i = (uint32_t)SDL_AtomicAdd(&rst.nextTile, 1);
+		if(i >= rst.numActiveTiles)
+			break;
+		const uint32_t tileId = rst.activeTiles[i];
+		RasterBin* bin = &rst.bins[tileId];
+		const int tx = (tileId % rst.tilesX)*RASTER_TILE_SIZE, ty = (tileId / rst.tilesX)*RASTER_TILE_SIZE;
+		const int tile[4] = { tx, ty,
+			tx+RASTER_TILE_SIZE < w ? tx+RASTER_TILE_SIZE : w, ty+RASTER_TILE_SIZE < h ? ty+RASTER_TILE_SIZE : h };
+		for(uint32_t j=0; j<bin->num; ++j)
+			rasterTriTile(&rst.tris[bin->tris[j]], tile, span);
+		bin->num = 0;
+	}
+}
+
+static int rasterWorker(void* arg) {
+	uint32_t* span = &rst.spans[(size_t)arg * RASTER_TILE_SIZE];
+	for(;;) {
+		SDL_SemWait(rst.start);
+		if(rst.quit)
+			break;
+		rasterTiles(span);
+		SDL_SemPost(rst.done);
+	}
+	return 0;
+}
+
+/// resizes the tile grid to the current target's dimensions, pending triangles must have been flushed
+static void binsSetup() {
+	const int w = rst.target ? rst.target->w : rst.screen.w, h = rst.target ? rst.target->h : rst.screen.h;
+	rst.tilesX = (w + RASTER_TILE_SIZE-1) / RASTER_TILE_SIZE;
+	rst.tilesY = (h + RASTER_TILE_SIZE-1) / RASTER_TILE_SIZE;
+	const uint32_t numBins = rst.tilesX * rst.tilesY;
+	if(numBins > rst.numBinsMax) {
+		rst.bins = (RasterBin*)realloc(rst.bins, numBins*sizeof(RasterBin));
+		memset(&rst.bins[rst.numBinsMax], 0, (numBins-rst.numBinsMax)*sizeof(RasterBin));
+		rst.numBinsMax = numBins;
+	}
+	if(numBins > rst.numActiveTilesMax) {
+		rst.numActiveTilesMax = numBins;
+		rst.activeTiles = (uint32_t*)realloc(rst.activeTiles, numBins*sizeof(uint32_t));
+	}
+}
+
+void rasterFlush() {
+	if(!rst.numTris)
+		return;
+	SDL_AtomicSet(&rst.nextTile, 0);
+	const int numWorkers = (int)rst.numActiveTiles-1 < rst.numWorkers ? (int)rst.numActiveTiles-1 : rst.numWorkers;
+	for(int i=0; i<numWorkers; ++i)
+		SDL_SemPost(rst.start);
+	rasterTiles(rst.spans);
+	for(int i=0; i<numWorkers; ++i)
+		SDL_SemWait(rst.done);
+	rst.numTris = rst.numActiveTiles = 0;
+}
+
+//--- triangle setup -----------------------------------------------
+
+static void binTriangle(const float* xy0, const float* xy1, const float* xy2,
+	const uint8_t* c0, const uint8_t* c1, const uint8_t* c2,
+	const float* uv0, const float* uv1, const float* uv2, RasterTexture* tex, int blendMode)
+{
+	float area = (xy1[0]-xy0[0])*(xy2[1]-xy0[1]) - (xy1[1]-xy0[1])*(xy2[0]-xy0[0]);
+	if(area == 0.0f || !isfinite(area))
+		return;
+	if(area < 0.0f) { // ensure a consistent winding order
+		const float* xy = xy1; xy1 = xy2; xy2 = xy;
+		const uint8_t* c = c1; c1 = c2; c2 = c;
+		const float* uv = uv1; uv1 = uv2; uv2 = uv;
+		area = -area;
+	}
+	const int w = rst.target ? rst.target->w : rst.screen.w, h = rst.target ? rst.target->h : rst.screen.h;
+	int bbox[4] = {
+		(int)floorf(fminf(xy0[0], fminf(xy1[0], xy2[0]))), (int)floorf(fminf(xy0[1], fminf(xy1[1], xy2[1]))),
+		(int)ceilf(fmaxf(xy0[0], fmaxf(xy1[0], xy2[0]))), (int)ceilf(fmaxf(xy0[1], fmaxf(xy1[1], xy2[1]))) };
+	const int clip[4] = { rst.clipEnabled ? rst.clip[0] : 0, rst.clipEnabled ? rst.clip[1] : 0,
+		rst.clipEnabled && rst.clip[2] < w ? rst.clip[2] : w, rst.clipEnabled && rst.clip[3] < h ? rst.clip[3] : h };
+	for(int i=0; i<2; ++i) {
+		if(bbox[i] < clip[i])
+			bbox[i] = clip[i];
+		if(bbox[i+2] > clip[i+2])
+			bbox[i+2] = clip[i+2];
+	}
+	if(bbox[0]>=bbox[2] || bbox[1]>=bbox[3])
+		return;
+
+	if(rst.numTris == rst.numTrisMax) {
+		rst.numTrisMax = rst.numTrisMax ? rst.numTrisMax*2 : 256;
+		rst.tris = (RasterTri*)realloc(rst.tris, rst.numTrisMax*sizeof(RasterTri));
+	}
+	const uint32_t triId = rst.numTris++;
+	RasterTri* t = &rst.tris[triId];
+	memcpy(t->bbox, bbox, sizeof(bbox));
+	t->tex = tex;
+	t->blendMode = blendMode;
+
+	// barycentric weight of each vertex is the normalized edge function of the opposite edge:
+	const float* v[3] = { xy0, xy1, xy2 };
+	for(int i=0; i<3; ++i) {
+		const float* a = v[(i+1)%3], *b = v[(i+2)%3];
+		const float dx = b[0]-a[0], dy = b[1]-a[1];
+		t->edge[i][0] = -dy/area;
+		t->edge[i][1] = dx/area;
+		t->edge[i][2] = (dy*a[0] - dx*a[1])/area;
+		t->topLeft[i] = dy < 0.0f || (dy == 0.0f && dx > 0.0f);
+	}
+
+	float attr[6][3];
+	uint32_t numAttr = 0;
+	if(tex) {
+		for(int i=0; i<3; ++i) {
+			const float* uv = i==0 ? uv0 : i==1 ? uv1 : uv2;
+			attr[0][i] = uv[0]*tex->w - 0.5f;
+			attr[1][i] = uv[1]*tex->h - 0.5f;
+		}
+		numAttr = 2;
+	}
+	const uint8_t* clr[3] = { c0, c1, c2 };
+	t->isFlat = memcmp(c0, c1, 4)==0 && memcmp(c0, c2, 4)==0;
+	memcpy(t->clr, c0, 4);
+	if(!t->isFlat) {
+		for(int j=0; j<4; ++j)
+			for(int i=0; i<3; ++i)
+				attr[numAttr+j][i] = clr[i][j];
+		numAttr += 4;
+	}
+	for(uint32_t k=0; k<numAttr; ++k) // attr = sum of weight*vertex value
+		for(int j=0; j<3; ++j)
+			t->plane[k][j] = attr[k][0]*t->edge[0][j] + attr[k][1]*t->edge[1][j] + attr[k][2]*t->edge[2][j];
+	if(!tex && !t->isFlat) // untextured gradients use the same plane slots as textured ones
+		memmove(&t->plane[2], &t->plane[0], 4*sizeof(t->plane[0]));
+
+	const int tx0 = bbox[0]/RASTER_TILE_SIZE, ty0 = bbox[1]/RASTER_TILE_SIZE;
+	const int tx1 = (bbox[2]-1)/RASTER_TILE_SIZE, ty1 = (bbox[3]-1)/RASTER_TILE_SIZE;
+	for(int ty=ty0; ty<=ty1; ++ty) for(int tx=tx0; tx<=tx1; ++tx) {
+		const uint32_t tileId = ty*rst.tilesX + tx;
+		RasterBin* bin = &rst.bins[tileId];
+		if(bin->num == bin->numMax) {
+			bin->numMax = bin->numMax ? bin->numMax*2 : 64;
+			bin->tris = (uint32_t*)realloc(bin->tris, bin->numMax*sizeof(uint32_t));
+		}
+		if(!bin->num)
+			rst.activeTiles[rst.numActiveTiles++] = tileId;
+		bin->tris[bin->num++] = triId;
+	}
+}
+
+static inline int vertexIndex(const void* indices, int indexSize, int i) {
+	if(!indices)
+		return i;
+	return indexSize==1 ? ((const uint8_t*)indices)[i]
+		: indexSize==2 ? ((const uint16_t*)indices)[i] : ((const int*)indices)[i];
+}
+
+void rasterGeometry(RasterTexture* tex, const float* xy, const uint8_t* rgba, int clrStride,
+	const float* uv, int numVertices, const void* indices, int numIndices, int indexSize, int blendMode)
+{
+	if(!rst.renderer)
+		return;
+	if(tex)
+		blendMode = tex->blendMode;
+	const int n = indices ? numIndices : numVertices;
+	for(int i=0; i+2<n; i+=3) {
+		const int i0 = vertexIndex(indices, indexSize, i), i1 = vertexIndex(indices, indexSize, i+1);
+		const int i2 = vertexIndex(indices, indexSize, i+2);
+		binTriangle(&xy[i0*2], &xy[i1*2], &xy[i2*2],
+			&rgba[i0*clrStride], &rgba[i1*clrStride], &rgba[i2*clrStride],
+			tex ? &uv[i0*2] : NULL, tex ? &uv[i1*2] : NULL, tex ? &uv[i2*2] : NULL, tex, blendMode);
+	}
+}
+
+void rasterPoints(const float* xy, int numPoints, const uint8_t rgba[4], int blendMode) {
+	for(int i=0; i<numPoints; ++i) {
+		const float x = floorf(xy[i*2]), y = floorf(xy[i*2+1]);
+		const float quad[] = { x,y, x+1.0f,y, x+1.0f,y+1.0f, x,y+1.0f };
+		static const uint8_t indices[] = { 0,1,2, 0,2,3 };
+		rasterGeometry(NULL, quad, rgba, 0, NULL, 4, indices, 6, 1, blendMode);
+	}
+}
+
+void rasterClear(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+	rasterFlush();
+	RasterTexture* target = rst.target ? rst.target : &rst.screen;
+	const uint32_t px = packRGBA(r, g, b, a), numPx = target->w*target->h;
+	for(uint32_t i=0; i<numPx; ++i)
+		target->px[i] = px;
+}
+
+//--- render targets and clipping ----------------------------------
+
+void rasterTarget(RasterTexture* tex) {
+	if(tex == rst.target)
+		return;
+	rasterFlush();
+	if(!rst.target) { // like SDL, keep the screen's clip rect and start targets unclipped
+		memcpy(rst.screenClip, rst.clip, sizeof(rst.clip));
+		rst.screenClipEnabled = rst.clipEnabled;
+		rst.clipEnabled = false;
+	}
+	else if(!tex) {
+		memcpy(rst.clip, rst.screenClip, sizeof(rst.clip));
+		rst.clipEnabled = rst.screenClipEnabled;
+	}
+	rst.target = tex;
+	binsSetup();
+}
+
+RasterTexture* rasterGetTarget() {
+	return rst.target;
+}
+
+void rasterTargetSize(int* w, int* h) {
+	const RasterTexture* target = rst.target ? rst.target : &rst.screen;
+	if(w)
+		*w = target->w;
+	if(h)
+		*h = target->h;
+}
+
+void rasterClipRect(const int* clip) {
+	rst.clipEnabled = clip!=NULL;
+	if(clip) {
+		rst.clip[0] = clip[0];
+		rst.clip[1] = clip[1];
+		rst.clip[2] = clip[0]+clip[2];
+		rst.clip[3] = clip[1]+clip[3];
+	}
+}
+
+bool rasterGetClipRect(int* clip) {
+	if(rst.clipEnabled && clip) {
+		clip[0] = rst.clip[0];
+		clip[1] = rst.clip[1];
+		clip[2] = rst.clip[2]-rst.clip[0];
+		clip[3] = rst.clip[3]-rst.clip[1];
+	}
+	return rst.clipEnabled;
+}
+
+//--- textures -----------------------------------------------------
+
+RasterTexture* rasterTextureCreate(int w, int h) {
+	if(w<=0 || h<=0)
+		return NULL;
+	RasterTexture* tex = (RasterTexture*)malloc(sizeof(RasterTexture));
+	tex->px = (uint32_t*)calloc((size_t)w*h, sizeof(uint32_t));
+	if(!tex->px) {
+		free(tex);
+		return NULL;
+	}
+	tex->w = w;
+	tex->h = h;
+	tex->blendMode = RASTER_BLEND_NONE;
+	tex->userData = NULL;
+	return tex;
+}
+
+void rasterTextureDestroy(RasterTexture* tex) {
+	if(!tex)
+		return;
+	rasterFlush();
+	if(rst.target == tex)
+		rasterTarget(NULL);
+	free(tex->px);
+	free(tex);
+}
+
+int rasterTextureUpdate(RasterTexture* tex, const int* rect, const void* pixels, int pitch) {
+	if(!tex || !pixels)
+		return -1;
+	const int x = rect ? rect[0] : 0, y = rect ? rect[1] : 0, w = rect ? rect[2] : tex->w, h = rect ? rect[3] : tex->h;
+	if(x<0 || y<0 || w<0 || h<0 || x+w > tex->w || y+h > tex->h)
+		return -1;
+	rasterFlush();
+	for(int j=0; j<h; ++j)
+		memcpy(&tex->px[(y+j)*tex->w + x], (const uint8_t*)pixels + j*pitch, w*sizeof(uint32_t));
+	return 0;
+}
+
+int rasterTextureUpdateYUV(RasterTexture* tex,
+	const uint8_t* yData, int yPitch, const uint8_t* uData, int uPitch, const uint8_t* vData, int vPitch)
+{
+	if(!tex || !yData || !uData || !vData)
+		return -1;
+	rasterFlush();
+	for(int y=0; y<tex->h; ++y) {
+		const uint8_t* yRow = &yData[y*yPitch], *uRow = &uData[(y/2)*uPitch], *vRow = &vData[(y/2)*vPitch];
+		uint32_t* dst = &tex->px[y*tex->w];
+		for(int x=0; x<tex->w; ++x) {
+			const int c = 298*(yRow[x]-16), d = uRow[x/2]-128, e = vRow[x/2]-128;
+			dst[x] = packRGBA((c + 409*e + 128) >> 8, (c - 100*d - 208*e + 128) >> 8, (c + 516*d + 128) >> 8, 255);
+		}
+	}
+	return 0;
+}
+
+void rasterTextureSize(const RasterTexture* tex, int* w, int* h) {
+	if(w)
+		*w = tex ? tex->w : 0;
+	if(h)
+		*h = tex ? tex->h : 0;
+}
+
+void rasterTextureBlendMode(RasterTexture* tex, int blendMode) {
+	tex->blendMode = blendMode;
+}
+
+int rasterTextureGetBlendMode(const RasterTexture* tex) {
+	return tex->blendMode;
+}
+
+void rasterTextureUserData(RasterTexture* tex, void* userData) {
+	tex->userData = userData;
+}
+
+void* rasterTextureGetUserData(const RasterTexture* tex) {
+	return tex->userData;
+}
+
+//--- lifecycle ----------------------------------------------------
+
+/// (re)allocates the screen framebuffer and its streaming texture to match the renderer's output size
+static bool screenResize() {
+	int w, h;
+	if(SDL_GetRendererOutputSize(rst.renderer, &w, &h)!=0 || w<=0 || h<=0)
+		return false;
+	if(rst.screenTex && w == rst.screen.w && h == rst.screen.h)
+		return true;
+	if(rst.screenTex)
+		SDL_DestroyTexture(rst.screenTex);
+	rst.screenTex = SDL_CreateTexture(rst.renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, w, h);
+	if(!rst.screenTex) {
+		SDL_Log("rasterizer cannot create screen texture: %s", SDL_GetError());
+		return false;
+	}
+	free(rst.screen.px);
+	free(rst.presentPx);
+	rst.screen.px = (uint32_t*)calloc((size_t)w*h, sizeof(uint32_t));
+	rst.presentPx = (uint32_t*)calloc((size_t)w*h, sizeof(uint32_t));
+	rst.screen.w = w;
+	rst.screen.h = h;
+	if(!rst.target)
+		binsSetup();
+	return true;
+}
+
+bool rasterInit(void* renderer, int numThreads) {
+	if(rst.renderer)
+		rasterClose();
+	memset(&rst, 0, sizeof(rst));
+	rst.renderer = (SDL_Renderer*)renderer;
+	if(!screenResize()) {
+		rst.renderer = NULL;
+		return false;
+	}
+	rst.blendAlpha = blendAlphaScalar;
+#ifdef RASTER_HAS_SSE2
+	if(SDL_HasSSE2())
+		rst.blendAlpha = blendAlphaSSE2;
+#endif
+	if(numThreads<=0)
+		numThreads = SDL_GetCPUCount();
+	rst.spans = (uint32_t*)malloc((size_t)numThreads*RASTER_TILE_SIZE*sizeof(uint32_t));
+	rst.start = SDL_CreateSemaphore(0);
+	rst.done = SDL_CreateSemaphore(0);
+	rst.threads = (SDL_Thread**)malloc(numThreads*sizeof(SDL_Thread*));
+	for(int i=1; i<numThreads; ++i) {
+		SDL_Thread* thread = SDL_CreateThread(rasterWorker, "rasterizer", (void*)(size_t)i);
+		if(!thread) {
+			SDL_Log("rasterizer cannot create thread: %s", SDL_GetError());
+			break;
+		}
+		rst.threads[rst.numWorkers++] = thread;
+	}
+	return true;
+}
+
+void rasterClose() {
+	if(!rst.renderer)
+		return;
+	rst.numTris = rst.numActiveTiles = 0;
+	rst.quit = true;
+	for(int i=0; i<rst.numWorkers; ++i)
+		SDL_SemPost(rst.start);
+	for(int i=0; i<rst.numWorkers; ++i)
+		SDL_WaitThread(rst.threads[i], NULL);
+	free(rst.threads);
+	SDL_DestroySemaphore(rst.start);
+	SDL_DestroySemaphore(rst.done);
+	for(uint32_t i=0; i<rst.numBinsMax; ++i)
+		free(rst.bins[i].tris);
+	free(rst.bins);
+	free(rst.activeTiles);
+	free(rst.tris);
+	free(rst.spans);
+	free(rst.screen.px);
+	free(rst.presentPx);
+	if(rst.screenTex)
+		SDL_DestroyTexture(rst.screenTex);
+	memset(&rst, 0, sizeof(rst));
+}
+
+bool rasterIsActive() {
+	return rst.renderer!=NULL;
+}
+
+int rasterNumThreads() {
+	return rst.renderer ? rst.numWorkers+1 : 0;
+}
+
+void rasterPresent() {
+	rasterFinishFrame();
+	rasterPresentFrame();
+}
+
+void rasterFinishFrame() {
+	if(!rst.renderer)
+		return;
+	rasterFlush();
+	uint32_t* px = rst.screen.px;
+	rst.screen.px = rst.presentPx;
+	rst.presentPx = px;
+}
+
+void rasterPresentFrame() {
+	if(!rst.renderer)
+		return;
+	SDL_UpdateTexture(rst.screenTex, NULL, rst.presentPx, rst.screen.w*sizeof(uint32_t));
+	SDL_RenderCopy(rst.renderer, rst.screenTex, NULL, NULL);
+	SDL_RenderPresent(rst.renderer);
+	if(!rst.target)
+		screenResize();
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//--- multi-threaded tile-based CPU rasterizer ---------------------
+/** Renders textured and colored triangles into an RGBA framebuffer as a replacement for
+ * SDL's single-threaded software renderer. Primitives are binned into screen tiles and
+ * the tiles are rasterized in parallel, preserving painter's order within each tile.
+ * The framebuffer is presented via a streaming texture of an SDL_Renderer. */
+
+typedef struct RasterTexture RasterTexture;
+
+/// blend modes, numerically identical to SDL_BlendMode
+typedef enum {
+	RASTER_BLEND_NONE = 0,
+	RASTER_BLEND_ALPHA = 1,
+	RASTER_BLEND_ADD = 2,
+	RASTER_BLEND_MOD = 4,
+	RASTER_BLEND_MUL = 8,
+} RasterBlendMode;
+
+/// initializes the rasterizer, presenting via renderer, an SDL_Renderer
+/** \param numThreads number of rasterizer threads including the calling one, values <=0 mean one per CPU core
+ * \return false if the screen texture could not be created */
+extern bool rasterInit(void* renderer, int numThreads);
+/// releases the framebuffer and terminates the worker threads
+extern void rasterClose();
+/// returns true if the rasterizer has been initialized
+extern bool rasterIsActive();
+/// returns the number of rasterizer threads including the calling one
+extern int rasterNumThreads();
+
+/// creates a texture of w*h transparent black RGBA pixels
+extern RasterTexture* rasterTextureCreate(int w, int h);
+extern void rasterTextureDestroy(RasterTexture* tex);
+/// copies a rectangle of RGBA32 pixels into tex, the whole texture if rect is NULL
+/** rect is an int[4] x,y,w,h. Pending draws are flushed first, as they may refer to the old content. */
+extern int rasterTextureUpdate(RasterTexture* tex, const int* rect, const void* pixels, int pitch);
+/// converts planar IYUV (BT.601) data into the RGBA pixels of tex
+extern int rasterTextureUpdateYUV(RasterTexture* tex,
+	const uint8_t* yData, int yPitch, const uint8_t* uData, int uPitch, const uint8_t* vData, int vPitch);
+extern void rasterTextureSize(const RasterTexture* tex, int* w, int* h);
+/// sets the blend mode of triangles using tex
+extern void rasterTextureBlendMode(RasterTexture* tex, int blendMode);
+extern int rasterTextureGetBlendMode(const RasterTexture* tex);
+extern void rasterTextureUserData(RasterTexture* tex, void* userData);
+extern void* rasterTextureGetUserData(const RasterTexture* tex);
+
+/// redirects rendering into tex, or to the screen if tex is NULL
+extern void rasterTarget(RasterTexture* tex);
+extern RasterTexture* rasterGetTarget();
+/// restricts rendering to the int[4] x,y,w,h rectangle clip, or turns clipping off if clip is NULL
+extern void rasterClipRect(const int* clip);
+/// returns true and the clip rectangle if clipping is enabled
+extern bool rasterGetClipRect(int* clip);
+/// returns the dimensions of the current render target
+extern void rasterTargetSize(int* w, int* h);
+
+/// fills the entire render target with an RGBA color, ignoring the clip rectangle
+extern void rasterClear(uint8_t r, uint8_t g, uint8_t b, uint8_t a);
+/// draws indexed or non-indexed triangles
+/** Equivalent to SDL_RenderGeometryRaw: xy and uv are interleaved float pairs, uv is ignored if tex is NULL.
+ * rgba points to 4 bytes per vertex spaced clrStride bytes apart, texels are modulated by these vertex colors.
+ * indices of indexSize 1, 2, or 4 bytes may be NULL. blendMode is only used for untextured triangles,
+ * textured ones use the texture's. */
+extern void rasterGeometry(RasterTexture* tex, const float* xy, const uint8_t* rgba, int clrStride,
+	const float* uv, int numVertices, const void* indices, int numIndices, int indexSize, int blendMode);
+/// draws single pixels in a uniform color
+extern void rasterPoints(const float* xy, int numPoints, const uint8_t rgba[4], int blendMode);
+/// rasterizes all pending primitives
+extern void rasterFlush();
+/// flushes and shows the screen framebuffer, adapting its size to the renderer's output size
+/** Equivalent to rasterFinishFrame() followed by rasterPresentFrame(). */
+extern void rasterPresent();
+/// rasterizes all pending primitives and sets the completed screen framebuffer aside for presentation
+/** Rendering continues into a second framebuffer of undefined content, so a frame may be drawn
+ * while the previous one still awaits rasterPresentFrame(). */
+extern void rasterFinishFrame();
+/// shows the framebuffer set aside by the last rasterFinishFrame(), adapting the framebuffers to the renderer's output size
+/** Must be called from the thread owning the SDL_Renderer, while no other thread uses the rasterizer. */
+extern void rasterPresentFrame();
@@ -4,11 +4,24 @@
 #include "graphicsUtils.h"
 
 #include "audio.h"
+#include "external/miniz.h"
+
+#include <SDL_thread.h>
+#include <SDL_mutex.h>
+#include <SDL_timer.h>
+#include <SDL_cpuinfo.h>
 
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <utime.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
 
 typedef struct {
 	char* name;
@@ -22,15 +35,69 @@ typedef struct {
 	unsigned size;
 } FontResource;
 
+/// shared texture page small images are packed into
+typedef struct {
+	size_t handle;
+	int filtering;
+	SkylinePacker packer;
+} AtlasPage;
+
+/// image requested via ResourceGetImageAsync, decoded by a loader thread
+typedef struct {
+	char* name;
+	float scale;
+	int filtering;
+	uint32_t tag;
+	/// decoded pixels, NULL in case of an error
+	unsigned char* data;
+	int w, h, d;
+} AsyncImage;
+
+/// FIFO queue of asynchronously loaded images
+typedef struct {
+	AsyncImage* items;
+	unsigned head, tail, numMax;
+} AsyncQueue;
+
 typedef struct {
 	Archive* ar;
+	/// serializes archive access of the main and loader threads
+	SDL_mutex* arLock;
 	FontResource* fonts;
 	unsigned numFonts, numFontsMax;
 	Resource *images, *samples;
 	unsigned numImages, numImagesMax, numSamples, numSamplesMax;
+	bool atlasPacking, fontSDF;
+	AtlasPage* pages;
+	unsigned numPages, numPagesMax;
+	/// loader threads, started on the first asynchronous request
+	SDL_Thread** loaders;
+	unsigned numLoaders;
+	SDL_mutex* asyncLock;
+	SDL_cond* asyncCond;
+	/// images to be decoded and decoded images to be uploaded
+	AsyncQueue asyncTodo, asyncDone;
+	unsigned numAsyncPending;
+	bool asyncQuit;
+	/// directory of cached rasterized SVG images, NULL if caching is disabled
+	char* svgCacheDir;
+	size_t svgCacheSize, svgCacheSizeMax;
+	bool svgCacheCompress;
+	SDL_mutex* svgCacheLock;
 } ResArchive;
 static ResArchive* ra = NULL;
 
+/// edge length of atlas pages
+static const int atlasPageSize = 1024;
+/// images exceeding this width or height get a texture of their own
+static const int atlasImageMax = 256;
+/// number of pixels each packed image is extruded by to avoid bleeding when filtering
+static const int atlasPadding = 1;
+/// upper limit of loader threads decoding images asynchronously
+static const unsigned loadersMax = 4;
+/// identifies files of the SVG cache and their format version
+static const char svgCacheMagic[4] = { 'a', 's', 'v', '1' };
+
 //--- functions ----------------------------------------------------
 
 const char* ResourceSuffix(const char* fname) {
@@ -105,35 +172,32 @@ ResourceTypeId ResourceType(const char* url) {
 }
 
 //------------------------------------------------------------------
+/// loads a file into a buffer of size+1 bytes, the last one being 0
 static void* ArchiveLoadBinary(Archive* ar, const char* fname, size_t* size) {
+	SDL_LockMutex(ra->arLock);
 	*size = ArchiveFileSize(ar, fname);
-	if(!*size)
-		return 0;
-
-	void* buf = malloc(*size);
-	size_t numBytesRead = ArchiveFileLoad(ar, fname, buf);
-	if(numBytesRead != *size) {
-		free(buf);
-		return 0;
+	void* buf = NULL;
+	if(*size) {
+		buf = malloc(*size+1);
+		((char*)buf)[*size] = 0;
+		if(ArchiveFileLoad(ar, fname, buf) != *size) {
+			free(buf);
+			buf = NULL;
+		}
 	}
+	SDL_UnlockMutex(ra->arLock);
 	return buf;
 }
 
-static size_t ArchiveLoadImage(Archive* ar, const char* fname) {
+static unsigned char* ArchiveLoadImageData(Archive* ar, const char* fname, int* w, int* h, int* d) {
 	size_t fsize;
 	void* buf = ArchiveLoadBinary(ar, fname, &fsize);
 	if(!buf)
 		return 0;
 
-	int w,h,d;
-	unsigned char *data = readImageData(buf, fsize, &w, &h, &d);
+	unsigned char *data = readImageData(buf, fsize, w, h, d);
 	free(buf);
-	if(!data)
-		return 0;
-
-	size_t img = gfxImageUpload(data, w, h, d, 0xff);
-	free(data);
-	return img;
+	return data;
 }
 
 static size_t ArchiveLoadSVG(char* svg, float scale) {
@@ -160,8 +224,284 @@ static size_t ArchiveLoadAudio(Archive* ar, const char* fname) {
 	return sample;
 }
 
+//--- atlas packing ------------------------------------------------
+
+/// converts pixel data of depth d to RGBA, extruding the outermost pixels by atlasPadding
+static unsigned char* atlasPaddedRGBA(const unsigned char* data, int w, int h, int d) {
+	const int p = atlasPadding, pw = w+2*p, ph = h+2*p;
+	unsigned char* rgba = (unsigned char*)malloc(pw*ph*4);
+	for(int y=0; y<ph; ++y) for(int x=0; x<pw; ++x) {
+		const int sx = x<p ? 0 : x-p>=w ? w-1 : x-p, sy = y<p ? 0 : y-p>=h ? h-1 : y-p;
+		const unsigned char* src = &data[(sy*w+sx)*d];
+		unsigned char* dst = &rgba[(y*pw+x)*4];
+		if(d<3) {
+			dst[0] = dst[1] = dst[2] = src[0];
+			dst[3] = (d==2) ? src[1] : 255;
+		}
+		else {
+			dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2];
+			dst[3] = (d==4) ? src[3] : 255;
+		}
+	}
+	return rgba;
+}
+
+/// packs a small image into a shared atlas page and returns a tile handle to it
+/** @return 0 if the image is too large or could not be packed */
+static size_t atlasInsert(const unsigned char* data, int w, int h, int d, int filtering) {
+	if(w>atlasImageMax || h>atlasImageMax || d<1 || d>4)
+		return 0;
+	const int pw = w+2*atlasPadding, ph = h+2*atlasPadding;
+	int x, y;
+	AtlasPage* page = NULL;
+	for(unsigned i=0; i<ra->numPages && !page; ++i)
+		if(ra->pages[i].filtering == filtering && skylineInsert(&ra->pages[i].packer, pw, ph, &x, &y))
+			page = &ra->pages[i];
+	if(!page) {
+		size_t handle = gfxImageCreate(atlasPageSize, atlasPageSize);
+		if(!handle)
+			return 0;
+		if(ra->numPages == ra->numPagesMax) {
+			ra->numPagesMax = ra->numPagesMax ? ra->numPagesMax*2 : 1;
+			ra->pages = (AtlasPage*)realloc(ra->pages, ra->numPagesMax*sizeof(AtlasPage));
+		}
+		page = &ra->pages[ra->numPages++];
+		page->handle = handle;
+		page->filtering = filtering;
+		skylineInit(&page->packer, atlasPageSize, atlasPageSize);
+		skylineInsert(&page->packer, pw, ph, &x, &y);
+	}
+
+	unsigned char* rgba = atlasPaddedRGBA(data, w, h, d);
+	int ret = gfxImageUpdate(page->handle, x, y, pw, ph, rgba);
+	free(rgba);
+	return (ret==0) ? gfxImageAtlasTile(page->handle, x+atlasPadding, y+atlasPadding, w, h) : 0;
+}
+
+/// uploads image data either into an atlas page or as an image of its own
+static size_t uploadImage(const unsigned char* data, int w, int h, int d, int filtering) {
+	size_t img = ra->atlasPacking ? atlasInsert(data, w, h, d, filtering) : 0;
+	return img ? img : gfxImageUpload(data, w, h, d, 0xff);
+}
+
+//--- SVG cache ----------------------------------------------------
+
+/// header of a cached rasterized SVG image, followed by its RGBA pixels
+typedef struct {
+	char magic[4];
+	uint32_t w, h;
+	/// size of the SVG source, guards against hash collisions
+	uint32_t svgSize;
+	/// size of the pixel data, which is deflated if less than w*h*4
+	uint32_t dataSize;
+} SvgCacheHeader;
+
+/// maximum width and height of cached images, bounding allocations for corrupt headers
+static const uint32_t svgCacheDimMax = 16384;
+
+/// cache file whose modification time tells when it was used last
+typedef struct {
+	char* name;
+	size_t size;
+	time_t lastUse;
+} SvgCacheFile;
+
+/// hashes SVG source, scale, and the archive the SVG belongs to, via 64 bit FNV-1a
+static uint64_t svgCacheKey(const char* svg, size_t svgSize, float scale) {
+	uint64_t hash = 14695981039346656037ull;
+	const char* path = ArchivePath(ra->ar);
+	const unsigned char* parts[] = { (const unsigned char*)svg, (const unsigned char*)&scale, (const unsigned char*)path };
+	const size_t sizes[] = { svgSize, sizeof(scale), strlen(path) };
+	for(int i=0; i<3; ++i)
+		for(size_t j=0; j<sizes[i]; ++j)
+			hash = (hash ^ parts[i][j]) * 1099511628211ull;
+	return hash;
+}
+
+static char* svgCacheFileName(uint64_t key, const char* suffix) {
+	const size_t len = strlen(ra->svgCacheDir) + 17 + strlen(suffix);
+	char* fname = (char*)malloc(len);
+	snprintf(fname, len, "%s%016llx%s", ra->svgCacheDir, (unsigned long long)key, suffix);
+	return fname;
+}
+
+static int svgCacheFileCompare(const void* a, const void* b) {
+	const time_t ta = ((const SvgCacheFile*)a)->lastUse, tb = ((const SvgCacheFile*)b)->lastUse;
+	return ta < tb ? -1 : ta > tb ? 1 : 0;
+}
+
+/// determines the total size of the cache, deleting least recently used files while it exceeds its limit
+/** To be called while holding svgCacheLock. Files are deleted until the cache is down to 3/4 of its limit,
+ * so the directory is not scanned again by every following store. */
+static void svgCacheTrim() {
+	DIR* dir = opendir(ra->svgCacheDir);
+	if(!dir)
+		return;
+	SvgCacheFile* files = NULL;
+	unsigned numFiles = 0, numFilesMax = 0;
+	ra->svgCacheSize = 0;
+	for(struct dirent* ent; (ent = readdir(dir)) != NULL; ) {
+		const char* suffix = ResourceSuffix(ent->d_name);
+		if(strcmp(suffix, "svgc")!=0)
+			continue;
+		const size_t len = strlen(ra->svgCacheDir) + strlen(ent->d_name) + 1;
+		char* fname = (char*)malloc(len);
+		snprintf(fname, len, "%s%s", ra->svgCacheDir, ent->d_name);
+		struct stat st;
+		if(stat(fname, &st)!=0) {
+			free(fname);
+			continue;
+		}
+		if(numFiles == numFilesMax) {
+			numFilesMax = numFilesMax ? numFilesMax*2 : 64;
+			files = (SvgCacheFile*)realloc(files, numFilesMax*sizeof(SvgCacheFile));
+		}
+		files[numFiles++] = (SvgCacheFile){ fname, st.st_size, st.st_mtime };
+		ra->svgCacheSize += st.st_size;
+	}
+	closedir(dir);
+
+	if(ra->svgCacheSize > ra->svgCacheSizeMax) {
+		qsort(files, numFiles, sizeof(SvgCacheFile), svgCacheFileCompare);
+		for(unsigned i=0; i<numFiles && ra->svgCacheSize > ra->svgCacheSizeMax/4*3; ++i)
+			if(remove(files[i].name)==0)
+				ra->svgCacheSize -= files[i].size;
+	}
+	for(unsigned i=0; i<numFiles; ++i)
+		free(files[i].name);
+	free(files);
+}
+
+/// returns the cached pixels of a rasterized SVG image, or NULL on a cache miss
+/** Stale or corrupt cache files are treated as a miss and deleted. */
+static unsigned char* svgCacheLoad(uint64_t key, size_t svgSize, int* w, int* h, int* d) {
+	if(!ra->svgCacheDir)
+		return NULL;
+	char* fname = svgCacheFileName(key, ".svgc");
+	FILE* fp = fopen(fname, "rb");
+	if(!fp) {
+		free(fname);
+		return NULL;
+	}
+	SvgCacheHeader hdr;
+	unsigned char* data = NULL, *buf = NULL;
+	if(fread(&hdr, sizeof(hdr), 1, fp)==1 && memcmp(hdr.magic, svgCacheMagic, 4)==0 && hdr.svgSize==svgSize
+		&& hdr.w && hdr.h && hdr.w <= svgCacheDimMax && hdr.h <= svgCacheDimMax
+		&& hdr.dataSize && hdr.dataSize <= hdr.w*hdr.h*4)
+	{
+		mz_ulong size = (mz_ulong)hdr.w*hdr.h*4;
+		data = (unsigned char*)malloc(size);
+		if(data && hdr.dataSize == size) {
+			if(fread(data, size, 1, fp)!=1) {
+				free(data);
+				data = NULL;
+			}
+		}
+		else if(data) {
+			buf = (unsigned char*)malloc(hdr.dataSize);
+			if(!buf || fread(buf, hdr.dataSize, 1, fp)!=1 || mz_uncompress(data, &size, buf, hdr.dataSize)!=MZ_OK
+				|| size != (mz_ulong)hdr.w*hdr.h*4)
+			{
+				free(data);
+				data = NULL;
+			}
+		}
+	}
+	fclose(fp);
+	free(buf);
+	if(data) {
+		*w = hdr.w;
+		*h = hdr.h;
+		*d = 4;
+		utime(fname, NULL); // marks the file as recently used
+	}
+	else
+		remove(fname);
+	free(fname);
+	return data;
+}
+
+/// stores the pixels of a rasterized SVG image in the cache
+static void svgCacheStore(uint64_t key, size_t svgSize, const unsigned char* data, int w, int h) {
+	if(!ra->svgCacheDir || (uint32_t)w > svgCacheDimMax || (uint32_t)h > svgCacheDimMax)
+		return;
+	SvgCacheHeader hdr;
+	memcpy(hdr.magic, svgCacheMagic, 4);
+	hdr.w = w;
+	hdr.h = h;
+	hdr.svgSize = svgSize;
+	const mz_ulong size = (mz_ulong)w*h*4;
+	unsigned char* buf = NULL;
+	mz_ulong bufSize = 0;
+	if(ra->svgCacheCompress) {
+		bufSize = mz_compressBound(size);
+		buf = (unsigned char*)malloc(bufSize);
+		if(buf && (mz_compress2(buf, &bufSize, data, size, MZ_BEST_SPEED)!=MZ_OK || bufSize >= size)) {
+			free(buf);
+			buf = NULL;
+		}
+	}
+	hdr.dataSize = buf ? bufSize : size;
+
+	// written under a temporary name first, so concurrent readers never see partial files,
+	// which is unique per thread, as loader threads may rasterize the same image concurrently:
+	char tmpSuffix[32];
+	snprintf(tmpSuffix, sizeof(tmpSuffix), ".%lx.tmp", (unsigned long)SDL_ThreadID());
+	char* tmpName = svgCacheFileName(key, tmpSuffix);
+	char* fname = svgCacheFileName(key, ".svgc");
+	FILE* fp = fopen(tmpName, "wb");
+	bool ok = fp && fwrite(&hdr, sizeof(hdr), 1, fp)==1 && fwrite(buf ? buf : data, hdr.dataSize, 1, fp)==1;
+	if(fp && fclose(fp)!=0)
+		ok = false;
+	if(ok && rename(tmpName, fname)==0) {
+		SDL_LockMutex(ra->svgCacheLock);
+		ra->svgCacheSize += sizeof(hdr) + hdr.dataSize;
+		if(ra->svgCacheSize > ra->svgCacheSizeMax)
+			svgCacheTrim();
+		SDL_UnlockMutex(ra->svgCacheLock);
+	}
+	else if(fp)
+		remove(tmpName);
+	free(tmpName);
+	free(fname);
+	free(buf);
+}
+
+void ResourceSVGCache(const char* dir, size_t sizeMax, bool compress) {
+	if(!ra)
+		return;
+	free(ra->svgCacheDir);
+	ra->svgCacheDir = NULL;
+	if(!dir || !sizeMax)
+		return;
+	const size_t len = strlen(dir) + 10;
+	char* cacheDir = (char*)malloc(len);
+	snprintf(cacheDir, len, "%ssvgcache/", dir);
+#ifdef _WIN32
+	_mkdir(cacheDir);
+#else
+	mkdir(cacheDir, 0755);
+#endif
+	struct stat st;
+	if(stat(cacheDir, &st)!=0 || !(st.st_mode & S_IFDIR)) {
+		fprintf(stderr, "ResourceSVGCache ERROR: cannot create cache directory '%s'\n", cacheDir);
+		free(cacheDir);
+		return;
+	}
+	if(!ra->svgCacheLock)
+		ra->svgCacheLock = SDL_CreateMutex();
+	ra->svgCacheDir = cacheDir;
+	ra->svgCacheSizeMax = sizeMax;
+	ra->svgCacheCompress = compress;
+	SDL_LockMutex(ra->svgCacheLock);
+	svgCacheTrim();
+	SDL_UnlockMutex(ra->svgCacheLock);
+}
+
 //------------------------------------------------------------------
 
+static void asyncLoadersStop();
+
 /// opens a resource archive for further processing
 size_t ResourceArchiveOpen(const char* url) {
 	if(ra)
@@ -175,13 +515,31 @@ size_t ResourceArchiveOpen(const char* url) {
 	ra->numFonts = ra->numFontsMax = 0;
 	ra->images = ra->samples = NULL;
 	ra->numImages = ra->numImagesMax = ra->numSamples = ra->numSamplesMax = 0;
+	ra->atlasPacking = ra->fontSDF = false;
+	ra->pages = NULL;
+	ra->numPages = ra->numPagesMax = 0;
+	ra->arLock = SDL_CreateMutex();
+	ra->loaders = NULL;
+	ra->numLoaders = 0;
+	ra->asyncLock = NULL;
+	ra->asyncCond = NULL;
+	memset(&ra->asyncTodo, 0, sizeof(AsyncQueue));
+	memset(&ra->asyncDone, 0, sizeof(AsyncQueue));
+	ra->numAsyncPending = 0;
+	ra->asyncQuit = false;
+	ra->svgCacheDir = NULL;
+	ra->svgCacheSize = ra->svgCacheSizeMax = 0;
+	ra->svgCacheCompress = false;
+	ra->svgCacheLock = NULL;
 	return (size_t)ar;
 }
 /// closes currently opened resources and archive
 void ResourceArchiveClose() {
 	if(!ra)
 		return;
+	asyncLoadersStop();
 	ArchiveClose(ra->ar);
+	SDL_DestroyMutex(ra->arLock);
 
 	for(unsigned i=0; i<ra->numFonts; ++i)
 		free(ra->fonts[i].name);
@@ -195,6 +553,12 @@ void ResourceArchiveClose() {
 		free(ra->samples[i].name);
 	free(ra->samples);
 
+	for(unsigned i=0; i<ra->numPages; ++i)
+		skylineRelease(&ra->pages[i].packer);
+	free(ra->pages);
+
+	free(ra->svgCacheDir);
+	SDL_DestroyMutex(ra->svgCacheLock);
 	free(ra);
 	ra = NULL;
 }
@@ -203,25 +567,26 @@ const char* ResourceArchiveName() {
 	return ra ? ArchivePath(ra->ar) : "";
 }
 
-size_t ResourceGetImage(const char* name, float scale, int filtering) {
-	int isImage = isImageFile(name);
-	if(!ra || !isImage) {
-		fprintf(stderr, "ResourceGetImage ERROR: Unrecognized image format '%s'\n", name);
-		return 0;
-	}
+void ResourceAtlasPacking(bool enabled) {
+	if(ra)
+		ra->atlasPacking = enabled;
+}
+
+void ResourceFontSDF(bool enabled) {
+	if(ra)
+		ra->fontSDF = enabled;
+}
 
+/// returns the handle of an already loaded image, or 0
+static size_t imageLookup(const char* name, float scale) {
+	const bool isSVG = isImageFile(name)==2;
 	for(unsigned i=0; i<ra->numImages; ++i) // lookup by name and scale
-		if((strcmp(ra->images[i].name, name)==0) && (isImage==1 || ra->images[i].scale == scale))
+		if((strcmp(ra->images[i].name, name)==0) && (!isSVG || ra->images[i].scale == scale))
 			return ra->images[i].handle;
-	gfxTextureFiltering(filtering);
-	size_t handle = (isImage==1) ?
-		ArchiveLoadImage(ra->ar, name) : ArchiveLoadSVG(ResourceGetText(name), scale);
-	if(!handle) {
-		fprintf(stderr, "ResourceGetImage ERROR: Failed to load image '%s'\n", name);
-		return 0;
-	}
+	return 0;
+}
 
-	// buffer:
+static void imageRegister(const char* name, float scale, size_t handle) {
 	if(ra->numImages == ra->numImagesMax) {
 		ra->numImagesMax = ra->numImagesMax ? ra->numImagesMax*2 : 1;
 		ra->images = (Resource*)realloc(ra->images, ra->numImagesMax*sizeof(Resource));
@@ -230,9 +595,206 @@ size_t ResourceGetImage(const char* name, float scale, int filtering) {
 	res->handle = handle;
 	res->name = strdup(name);
 	res->scale = scale;
+}
+
+/// loads and decodes or rasterizes an image, safe to be called by loader threads
+static unsigned char* imageDecode(const char* name, float scale, int* w, int* h, int* d) {
+	if(isImageFile(name)==1)
+		return ArchiveLoadImageData(ra->ar, name, w, h, d);
+	size_t svgSize;
+	char* svg = (char*)ArchiveLoadBinary(ra->ar, name, &svgSize);
+	if(!svg)
+		return NULL;
+	const uint64_t key = svgCacheKey(svg, svgSize, scale);
+	unsigned char* data = svgCacheLoad(key, svgSize, w, h, d);
+	if(!data) {
+		data = svgRasterize(svg, scale, w, h, d);
+		if(data)
+			svgCacheStore(key, svgSize, data, *w, *h);
+	}
+	free(svg);
+	return data;
+}
+
+size_t ResourceGetImage(const char* name, float scale, int filtering) {
+	if(!ra || !isImageFile(name)) {
+		fprintf(stderr, "ResourceGetImage ERROR: Unrecognized image format '%s'\n", name);
+		return 0;
+	}
+	size_t handle = imageLookup(name, scale);
+	if(handle)
+		return handle;
+
+	gfxTextureFiltering(filtering);
+	int w, h, d;
+	unsigned char* data = imageDecode(name, scale, &w, &h, &d);
+	handle = data ? uploadImage(data, w, h, d, filtering) : 0;
+	free(data);
+	if(!handle) {
+		fprintf(stderr, "ResourceGetImage ERROR: Failed to load image '%s'\n", name);
+		return 0;
+	}
+	imageRegister(name, scale, handle);
 	return handle;
 }
 
+//--- asynchronous image loading -----------------------------------
+
+static void asyncQueuePush(AsyncQueue* q, const AsyncImage* item) {
+	if(q->head && q->tail == q->numMax) { // reclaim space of already popped items
+		memmove(q->items, q->items+q->head, (q->tail-q->head)*sizeof(AsyncImage));
+		q->tail -= q->head;
+		q->head = 0;
+	}
+	if(q->tail == q->numMax) {
+		q->numMax = q->numMax ? q->numMax*2 : 8;
+		q->items = (AsyncImage*)realloc(q->items, q->numMax*sizeof(AsyncImage));
+	}
+	q->items[q->tail++] = *item;
+}
+
+static bool asyncQueuePop(AsyncQueue* q, AsyncImage* item) {
+	if(q->head == q->tail)
+		return false;
+	*item = q->items[q->head++];
+	if(q->head == q->tail)
+		q->head = q->tail = 0;
+	return true;
+}
+
+static void asyncQueueRelease(AsyncQueue* q) {
+	for(unsigned i=q->head; i<q->tail; ++i) {
+		free(q->items[i].name);
+		free(q->items[i].data);
+	}
+	free(q->items);
+	memset(q, 0, sizeof(AsyncQueue));
+}
+
+static int asyncLoaderThread(void* udata) {
+	(void)udata;
+	SDL_LockMutex(ra->asyncLock);
+	while(true) {
+		AsyncImage img;
+		if(!asyncQueuePop(&ra->asyncTodo, &img)) {
+			if(ra->asyncQuit)
+				break;
+			SDL_CondWait(ra->asyncCond, ra->asyncLock);
+			continue;
+		}
+		SDL_UnlockMutex(ra->asyncLock);
+		img.data = imageDecode(img.name, img.scale, &img.w, &img.h, &img.d);
+		SDL_LockMutex(ra->asyncLock);
+		asyncQueuePush(&ra->asyncDone, &img);
+	}
+	SDL_UnlockMutex(ra->asyncLock);
+	return 0;
+}
+
+static bool asyncLoadersStart() {
+	if(ra->numLoaders)
+		return true;
+	const int numCPUs = SDL_GetCPUCount();
+	// leave one core to the main thread:
+	const unsigned numLoaders = numCPUs<=2 ? 1 : (unsigned)numCPUs-1 < loadersMax ? (unsigned)numCPUs-1 : loadersMax;
+	if(!ra->asyncLock)
+		ra->asyncLock = SDL_CreateMutex();
+	if(!ra->asyncCond)
+		ra->asyncCond = SDL_CreateCond();
+	if(!ra->asyncLock || !ra->asyncCond) {
+		fprintf(stderr, "ResourceGetImageAsync ERROR: %s\n", SDL_GetError());
+		return false;
+	}
+	ra->asyncQuit = false;
+	ra->loaders = (SDL_Thread**)malloc(numLoaders*sizeof(SDL_Thread*));
+	for(unsigned i=0; i<numLoaders; ++i) {
+		SDL_Thread* thread = SDL_CreateThread(asyncLoaderThread, "resourceLoader", NULL);
+		if(thread)
+			ra->loaders[ra->numLoaders++] = thread;
+	}
+	if(!ra->numLoaders)
+		fprintf(stderr, "ResourceGetImageAsync ERROR: %s\n", SDL_GetError());
+	return ra->numLoaders>0;
+}
+
+/// terminates the loader threads, discarding all pending requests
+static void asyncLoadersStop() {
+	if(ra->asyncLock) {
+		SDL_LockMutex(ra->asyncLock);
+		ra->asyncQuit = true;
+		asyncQueueRelease(&ra->asyncTodo); // loaders finish their current image only
+		SDL_CondBroadcast(ra->asyncCond);
+		SDL_UnlockMutex(ra->asyncLock);
+	}
+	for(unsigned i=0; i<ra->numLoaders; ++i)
+		SDL_WaitThread(ra->loaders[i], NULL);
+	free(ra->loaders);
+	ra->loaders = NULL;
+	ra->numLoaders = 0;
+	asyncQueueRelease(&ra->asyncDone);
+	SDL_DestroyCond(ra->asyncCond);
+	SDL_DestroyMutex(ra->asyncLock);
+	ra->asyncCond = NULL;
+	ra->asyncLock = NULL;
+	ra->numAsyncPending = 0;
+}
+
+bool ResourceGetImageAsync(const char* name, float scale, int filtering, uint32_t tag) {
+	if(!ra || !isImageFile(name)) {
+		fprintf(stderr, "ResourceGetImageAsync ERROR: Unrecognized image format '%s'\n", name);
+		return false;
+	}
+	if(!asyncLoadersStart())
+		return false;
+	AsyncImage img = { strdup(name), scale, filtering, tag, NULL, 0, 0, 0 };
+	SDL_LockMutex(ra->asyncLock);
+	if(imageLookup(name, scale)) // already loaded, only needs to be reported
+		asyncQueuePush(&ra->asyncDone, &img);
+	else {
+		asyncQueuePush(&ra->asyncTodo, &img);
+		SDL_CondSignal(ra->asyncCond);
+	}
+	SDL_UnlockMutex(ra->asyncLock);
+	++ra->numAsyncPending;
+	return true;
+}
+
+unsigned ResourceAsyncUpdate(double budget, ResourceAsyncCallback cb, void* udata) {
+	if(!ra || !ra->numAsyncPending)
+		return 0;
+	const Uint64 start = SDL_GetPerformanceCounter();
+	const Uint64 maxTicks = budget * SDL_GetPerformanceFrequency();
+	do {
+		AsyncImage img;
+		SDL_LockMutex(ra->asyncLock);
+		const bool isDone = asyncQueuePop(&ra->asyncDone, &img);
+		SDL_UnlockMutex(ra->asyncLock);
+		if(!isDone)
+			break;
+
+		// the same image may have been requested more than once:
+		size_t handle = imageLookup(img.name, img.scale);
+		if(!handle && img.data) {
+			gfxTextureFiltering(img.filtering);
+			handle = uploadImage(img.data, img.w, img.h, img.d, img.filtering);
+			if(handle)
+				imageRegister(img.name, img.scale, handle);
+		}
+		if(!handle)
+			fprintf(stderr, "ResourceGetImageAsync ERROR: Failed to load image '%s'\n", img.name);
+		--ra->numAsyncPending;
+		if(cb)
+			cb(udata, img.tag, handle);
+		free(img.data);
+		free(img.name);
+	} while(ra && ra->numAsyncPending && SDL_GetPerformanceCounter() - start < maxTicks);
+	return ra ? ra->numAsyncPending : 0;
+}
+
+unsigned ResourceAsyncPending() {
+	return ra ? ra->numAsyncPending : 0;
+}
+
 size_t ResourceGetAudio(const char* name) {
 	if(!ra || !isAudioFile(name))
 		return 0;
@@ -260,19 +822,26 @@ size_t ResourceGetAudio(const char* name) {
 size_t ResourceGetFont(const char* name, unsigned fontSize) {
 	if(!ra)
 		return 0;
-	for(unsigned i=0; i<ra->numFonts; ++i)
-		if(strcmp(ra->fonts[i].name, name)==0 && fontSize==ra->fonts[i].size)
+	size_t handle = 0;
+	for(unsigned i=0; i<ra->numFonts; ++i) {
+		if(strcmp(ra->fonts[i].name, name)!=0)
+			continue;
+		if(fontSize==ra->fonts[i].size)
 			return ra->fonts[i].handle;
-
-	size_t fsize;
-	void* buf = ArchiveLoadBinary(ra->ar, name, &fsize);
-	if(!buf) {
-		fprintf(stderr, "Could not load font file '%s'.\n", name);
-		return 0;
+		if(!handle) // other sizes share the already loaded font data
+			handle = gfxFontResize(ra->fonts[i].handle, fontSize);
 	}
 
-	size_t handle = gfxFontUpload(buf, fsize, fontSize);
-	free(buf);
+	if(!handle) {
+		size_t fsize;
+		void* buf = ArchiveLoadBinary(ra->ar, name, &fsize);
+		if(!buf) {
+			fprintf(stderr, "Could not load font file '%s'.\n", name);
+			return 0;
+		}
+		handle = ra->fontSDF ? gfxFontUploadSDF(buf, fsize, fontSize) : gfxFontUpload(buf, fsize, fontSize);
+		free(buf);
+	}
 	if(!handle)
 		fprintf(stderr, "Could not upload font file '%s', size %u.\n", name, fontSize);
 	else {
@@ -291,35 +860,14 @@ size_t ResourceGetFont(const char* name, unsigned fontSize) {
 char* ResourceGetText(const char* name) {
 	if(!ra)
 		return 0;
-
-	const size_t fsize = ArchiveFileSize(ra->ar, name);
-	if(!fsize)
-		return 0;
-
-	char* buf =(char*)malloc(fsize+1);
-	buf[fsize] = 0;
-	const size_t numBytesRead = ArchiveFileLoad(ra->ar, name, buf);
-	if(numBytesRead != fsize) {
-		free(buf);
-		return 0;
-	}
-	return buf;
+	size_t fsize;
+	return (char*)ArchiveLoadBinary(ra->ar, name, &fsize);
 }
 
 void* ResourceGetBinary(const char* name, size_t* numBytes) {
 	if(!numBytes || !ra)
 		return 0;
-	*numBytes = ArchiveFileSize(ra->ar, name);
-	if(!*numBytes)
-		return 0;
-
-	void* buf = malloc(*numBytes);
-	const size_t numBytesRead = ArchiveFileLoad(ra->ar, name, buf);
-	if(numBytesRead != *numBytes) {
-		free(buf);
-		return 0;
-	}
-	return buf;
+	return ArchiveLoadBinary(ra->ar, name, numBytes);
 }
 
 size_t ResourceCreateCircleImage(
@@ -2,6 +2,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 /// symbolic names for resource types
 typedef enum {
@@ -25,10 +26,33 @@ extern ResourceTypeId ResourceType(const char* url);
 extern char* ResourceBaseName(const char* fname);
 /// returns name/url of resource archive itself
 extern const char* ResourceArchiveName();
+/// enables or disables packing of subsequently loaded small images into shared atlas textures
+extern void ResourceAtlasPacking(bool enabled);
+/// enables or disables rendering of subsequently loaded fonts via signed distance fields shared by all sizes
+extern void ResourceFontSDF(bool enabled);
+/// caches rasterized SVG images of the archive in a subdirectory of dir, so they need not be rasterized again
+/** @param dir directory including a trailing path separator, for example SDL_GetPrefPath()
+ * @param sizeMax limit of the total size of cached images in bytes, least recently used images are evicted first,
+ *   0 disables caching
+ * @param compress if set, cached images are deflated */
+extern void ResourceSVGCache(const char* dir, size_t sizeMax, bool compress);
 
 /// returns handle to an image resource
 /** @param scale only relevant for SVG images */
 extern size_t ResourceGetImage(const char* name, float scale, int filtering);
+/// receives the tag of an asynchronously loaded image and its handle, 0 in case of an error
+typedef void (*ResourceAsyncCallback)(void* udata, uint32_t tag, size_t handle);
+/// requests an image resource to be read and decoded by a pool of loader threads
+/** Only the upload to graphics memory takes place on the main thread, within ResourceAsyncUpdate().
+ * @param tag identifies the request in the callback of ResourceAsyncUpdate()
+ * @return false if the request could not be queued */
+extern bool ResourceGetImageAsync(const char* name, float scale, int filtering, uint32_t tag);
+/// uploads asynchronously decoded images and reports them via cb, to be called once per frame
+/** Uploading stops once budget seconds have passed, but at least one image is processed per call.
+ * @return number of still pending requests */
+extern unsigned ResourceAsyncUpdate(double budget, ResourceAsyncCallback cb, void* udata);
+/// returns the number of asynchronous requests not yet reported
+extern unsigned ResourceAsyncPending();
 /// returns handle to an audio resource
 extern size_t ResourceGetAudio(const char* name);
 /// returns handle to a font resource
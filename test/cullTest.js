@@ -0,0 +1,27 @@
+app.setBackground(255,255,255);
+app.resizable(true);
+// mirrored (negatively scaled) sprites hanging over all four viewport edges.
+// Each red arrow must stay partially visible, next to its unmirrored green counterpart.
+var size = 64;
+var arrow = app.createPathResource(size,size, 'M 31 0 L 0 63 L 31 47 L 63 63 z')
+var stride = 3, data = new Float32Array(8*stride);
+
+function layout(w, h) {
+	var d = size/2; // visible part of each sprite
+	var pos = [
+		d,h/2, w+d,h/2, w/2,d, w/2,h+d, // mirrored: extend towards the origin
+		-d,h/3, w-d,h/3, w/3,-d, w/3,h-d ]; // unmirrored: extend away from it
+	for(var i=0; i<8; ++i) {
+		data[i*stride] = pos[i*2];
+		data[i*stride+1] = pos[i*2+1];
+		data[i*stride+2] = i<4 ? -1 : 1;
+	}
+}
+layout(app.width, app.height);
+app.on('resize', layout);
+
+app.on('draw', function(gfx) {
+	gfx.color(255,85,85).drawImages(arrow, stride, gfx.COMP_SCALE, data.subarray(0, 4*stride));
+	gfx.color(85,170,85).drawImages(arrow, stride, gfx.COMP_SCALE, data.subarray(4*stride));
+	gfx.color(0,0,0).fillText(0, app.height/2-40, 'all 8 arrows must be partially visible');
+});
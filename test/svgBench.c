@@ -0,0 +1,77 @@
+#include "../graphicsUtils.h"
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// referenced by graphicsUtils.c, not needed for rasterizing
+uint32_t gfxImageUpload(const unsigned char* data, int w, int h, int d, uint32_t rMask) {
+	return 0;
+}
+
+/// rasterizes a copy of svg, as parsing modifies it, and returns the seconds taken
+static double rasterize(const char* svg, float scale, unsigned char** img, int* w, int* h) {
+	char* copy = strdup(svg);
+	int d;
+	const Uint64 start = SDL_GetPerformanceCounter();
+	*img = svgRasterize(copy, scale, w, h, &d);
+	const double secs = (SDL_GetPerformanceCounter()-start) / (double)SDL_GetPerformanceFrequency();
+	free(copy);
+	return secs;
+}
+
+int main(int argc, char** argv) {
+	static const char* defaultFiles[] = { "../examples/asteroludi/graphics.svg", "../examples/return/icons.svg",
+		"../examples/hello/hello_arcajs.svg", "../browser_runtime/font12x16.svg", NULL };
+	static const int threadCounts[] = { 1, 2, 4, 8 };
+	const float scale = argc>1 ? atof(argv[1]) : 3.0f;
+	const char** files = argc>2 ? (const char**)argv+2 : defaultFiles;
+
+	printf("scale %.1f, %i CPU cores\n", scale, SDL_GetCPUCount());
+	printf("%-40s %11s %9s %9s %9s %9s\n", "file", "size", "1 thread", "2", "4", "8");
+	for(const char** fname = files; *fname; ++fname) {
+		char* svg = NULL;
+		if(!loadFile(*fname, false, (void**)&svg)) {
+			printf("%-40s not found\n", *fname);
+			continue;
+		}
+		unsigned char* ref = NULL;
+		int w = 0, h = 0;
+		printf("%-40s", *fname);
+		for(size_t i=0; i<sizeof(threadCounts)/sizeof(threadCounts[0]); ++i) {
+			svgRasterThreads(threadCounts[i]);
+			unsigned char* img;
+			double secs = rasterize(svg, scale, &img, &w, &h);
+			for(int run=0; run<2; ++run) { // best of three
+				free(img);
+				const double t = rasterize(svg, scale, &img, &w, &h);
+				if(t < secs)
+					secs = t;
+			}
+			if(!img)
+				break;
+			if(!i)
+				printf(" %5ix%-5i", w, h);
+			// bands restart nanosvg's incremental edge stepping, so coverage may differ slightly:
+			int alphaDiff = 0;
+			for(size_t j=3; ref && j<(size_t)w*h*4; j+=4) {
+				const int diff = abs((int)ref[j] - (int)img[j]);
+				if(diff > alphaDiff)
+					alphaDiff = diff;
+			}
+			printf(" %7.1fms", secs*1000.0);
+			if(alphaDiff)
+				printf("~%i", alphaDiff);
+			if(ref)
+				free(img);
+			else
+				ref = img;
+		}
+		printf("\n");
+		free(ref);
+		free(svg);
+	}
+	printf("~n marks the maximum alpha difference to the single-threaded result\n");
+	return 0;
+}
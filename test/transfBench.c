@@ -0,0 +1,53 @@
+#include "../transf2d.h"
+
+#include <SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/// compares a kernel's results against the scalar reference implementation
+static int verify(Transf2dIsa isa, const float* transf, const float* arr, uint32_t arrSz) {
+	float* ref = (float*)malloc(arrSz*sizeof(float));
+	float* out = (float*)malloc(arrSz*sizeof(float));
+	transf2dSelect(TRANSF2D_SCALAR);
+	transf2d(transf, arrSz, arr, ref);
+	transf2dSelect(isa);
+	transf2d(transf, arrSz, arr, out);
+	int numErrors = 0;
+	for(uint32_t i=0; i<arrSz; ++i)
+		if(fabsf(out[i]-ref[i]) > 1.0e-3f * (1.0f+fabsf(ref[i])))
+			++numErrors;
+	free(out);
+	free(ref);
+	return numErrors;
+}
+
+int main(int argc, char** argv) {
+	const uint32_t numCoords = argc>1 ? atoi(argv[1]) : 4096, numRuns = argc>2 ? atoi(argv[2]) : 2000;
+	const uint32_t arrSz = numCoords*2 + 1; // odd size exercises the scalar tails
+	float* arr = (float*)malloc(arrSz*sizeof(float));
+	float* out = (float*)malloc(arrSz*sizeof(float));
+	for(uint32_t i=0; i<arrSz; ++i)
+		arr[i] = (rand()%20000)/10.0f - 1000.0f;
+	const float rot = 0.3f, sc = 1.5f;
+	const float transf[] = { cosf(rot)*sc, -sinf(rot)*sc, 320.0f, sinf(rot)*sc, cosf(rot)*sc, 240.0f };
+
+	printf("transf2d default kernel: %s\n", transf2dIsaName(transf2dIsa()));
+	printf("%u coords x %u runs\n", numCoords, numRuns);
+	for(int isa = TRANSF2D_SCALAR; isa < TRANSF2D_NUM_ISAS; ++isa) {
+		if(!transf2dSelect(isa)) {
+			printf("%-8s not supported\n", transf2dIsaName(isa));
+			continue;
+		}
+		int numErrors = verify(isa, transf, arr, arrSz);
+		const Uint64 start = SDL_GetPerformanceCounter();
+		for(uint32_t run=0; run<numRuns; ++run)
+			transf2d(transf, arrSz, arr, out);
+		const double secs = (SDL_GetPerformanceCounter()-start) / (double)SDL_GetPerformanceFrequency();
+		printf("%-8s %8.1f Mcoords/s%s\n", transf2dIsaName(isa),
+			numCoords*(double)numRuns/secs/1.0e6, numErrors ? " MISMATCH" : "");
+	}
+	free(out);
+	free(arr);
+	return 0;
+}
@@ -0,0 +1,136 @@
+#include "transf2d.h"
+
+#include <SDL_cpuinfo.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#  define TRANSF2D_HAS_SSE2
+#  include <emmintrin.h>
+#  if defined(__GNUC__) || defined(__clang__)
+#    define TRANSF2D_HAS_AVX2
+#    include <immintrin.h>
+#  endif
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define TRANSF2D_HAS_NEON
+#  include <arm_neon.h>
+#endif
+
+typedef void (*Transf2dFunc)(const float transf[6], uint32_t arrSz, const float* arrIn, float* arrOut);
+
+//--- kernels ------------------------------------------------------
+
+static void transf2dScalar(const float transf[6], uint32_t arrSz, const float* arrIn, float* arrOut) {
+	for(uint32_t i=0; i+1<arrSz; i+=2) {
+		float x=arrIn[i], y=arrIn[i+1];
+		arrOut[i] = x*transf[0] + y*transf[1] + transf[2];
+		arrOut[i+1] = x*transf[3] + y*transf[4] + transf[5];
+	}
+}
+
+#ifdef TRANSF2D_HAS_SSE2
+static void transf2dSSE2(const float transf[6], uint32_t arrSz, const float* arrIn, float* arrOut) {
+	// two x|y pairs per register, each output lane combines its pair's duplicated x and y:
+	const __m128 mx = _mm_setr_ps(transf[0], transf[3], transf[0], transf[3]);
+	const __m128 my = _mm_setr_ps(transf[1], transf[4], transf[1], transf[4]);
+	const __m128 t = _mm_setr_ps(transf[2], transf[5], transf[2], transf[5]);
+	uint32_t i=0;
+	for(; i+8<=arrSz; i+=8) {
+		const __m128 v0 = _mm_loadu_ps(&arrIn[i]), v1 = _mm_loadu_ps(&arrIn[i+4]);
+		const __m128 x0 = _mm_shuffle_ps(v0, v0, _MM_SHUFFLE(2,2,0,0)), y0 = _mm_shuffle_ps(v0, v0, _MM_SHUFFLE(3,3,1,1));
+		const __m128 x1 = _mm_shuffle_ps(v1, v1, _MM_SHUFFLE(2,2,0,0)), y1 = _mm_shuffle_ps(v1, v1, _MM_SHUFFLE(3,3,1,1));
+		_mm_storeu_ps(&arrOut[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(x0, mx), _mm_mul_ps(y0, my)), t));
+		_mm_storeu_ps(&arrOut[i+4], _mm_add_ps(_mm_add_ps(_mm_mul_ps(x1, mx), _mm_mul_ps(y1, my)), t));
+	}
+	transf2dScalar(transf, arrSz-i, &arrIn[i], &arrOut[i]);
+}
+#endif
+
+#ifdef TRANSF2D_HAS_AVX2
+__attribute__((target("avx2")))
+static void transf2dAVX2(const float transf[6], uint32_t arrSz, const float* arrIn, float* arrOut) {
+	const __m256 mx = _mm256_setr_ps(transf[0], transf[3], transf[0], transf[3], transf[0], transf[3], transf[0], transf[3]);
+	const __m256 my = _mm256_setr_ps(transf[1], transf[4], transf[1], transf[4], transf[1], transf[4], transf[1], transf[4]);
+	const __m256 t = _mm256_setr_ps(transf[2], transf[5], transf[2], transf[5], transf[2], transf[5], transf[2], transf[5]);
+	uint32_t i=0;
+	for(; i+16<=arrSz; i+=16) {
+		const __m256 v0 = _mm256_loadu_ps(&arrIn[i]), v1 = _mm256_loadu_ps(&arrIn[i+8]);
+		const __m256 r0 = _mm256_add_ps(_mm256_add_ps(
+			_mm256_mul_ps(_mm256_moveldup_ps(v0), mx), _mm256_mul_ps(_mm256_movehdup_ps(v0), my)), t);
+		const __m256 r1 = _mm256_add_ps(_mm256_add_ps(
+			_mm256_mul_ps(_mm256_moveldup_ps(v1), mx), _mm256_mul_ps(_mm256_movehdup_ps(v1), my)), t);
+		_mm256_storeu_ps(&arrOut[i], r0);
+		_mm256_storeu_ps(&arrOut[i+8], r1);
+	}
+	transf2dScalar(transf, arrSz-i, &arrIn[i], &arrOut[i]);
+}
+#endif
+
+#ifdef TRANSF2D_HAS_NEON
+static void transf2dNEON(const float transf[6], uint32_t arrSz, const float* arrIn, float* arrOut) {
+	const float32x4_t tx = vdupq_n_f32(transf[2]), ty = vdupq_n_f32(transf[5]);
+	uint32_t i=0;
+	for(; i+8<=arrSz; i+=8) {
+		const float32x4x2_t v = vld2q_f32(&arrIn[i]); // deinterleaves 4 x and 4 y values
+		float32x4x2_t r;
+		r.val[0] = vmlaq_n_f32(vmlaq_n_f32(tx, v.val[0], transf[0]), v.val[1], transf[1]);
+		r.val[1] = vmlaq_n_f32(vmlaq_n_f32(ty, v.val[0], transf[3]), v.val[1], transf[4]);
+		vst2q_f32(&arrOut[i], r);
+	}
+	transf2dScalar(transf, arrSz-i, &arrIn[i], &arrOut[i]);
+}
+#endif
+
+//--- dispatch -----------------------------------------------------
+
+static Transf2dIsa isa = TRANSF2D_SCALAR;
+static Transf2dFunc kernel = NULL;
+
+static Transf2dFunc transf2dKernel(Transf2dIsa id) {
+	switch(id) {
+	case TRANSF2D_SCALAR:
+		return transf2dScalar;
+#ifdef TRANSF2D_HAS_SSE2
+	case TRANSF2D_SSE2:
+		return SDL_HasSSE2() ? transf2dSSE2 : NULL;
+#endif
+#ifdef TRANSF2D_HAS_AVX2
+	case TRANSF2D_AVX2:
+		return SDL_HasAVX2() ? transf2dAVX2 : NULL;
+#endif
+#ifdef TRANSF2D_HAS_NEON
+	case TRANSF2D_NEON:
+		return SDL_HasNEON() ? transf2dNEON : NULL;
+#endif
+	default:
+		return NULL;
+	}
+}
+
+bool transf2dSelect(Transf2dIsa id) {
+	Transf2dFunc func = transf2dKernel(id);
+	if(!func)
+		return false;
+	isa = id;
+	kernel = func;
+	return true;
+}
+
+Transf2dIsa transf2dIsa() {
+	if(!kernel)
+		transf2d(NULL, 0, NULL, NULL);
+	return isa;
+}
+
+const char* transf2dIsaName(Transf2dIsa id) {
+	static const char* names[] = { "scalar", "SSE2", "AVX2", "NEON" };
+	return (id < TRANSF2D_NUM_ISAS) ? names[id] : "unknown";
+}
+
+void transf2d(const float transf[6], uint32_t arrSz, const float* arrIn, float* arrOut) {
+	if(!kernel) { // pick the fastest supported kernel on first use
+		if(!transf2dSelect(TRANSF2D_AVX2) && !transf2dSelect(TRANSF2D_NEON) && !transf2dSelect(TRANSF2D_SSE2))
+			transf2dSelect(TRANSF2D_SCALAR);
+	}
+	if(arrSz>1)
+		kernel(transf, arrSz, arrIn, arrOut);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/// instruction set variants of the affine 2d array transformation
+typedef enum {
+	TRANSF2D_SCALAR = 0,
+	TRANSF2D_SSE2,
+	TRANSF2D_AVX2,
+	TRANSF2D_NEON,
+	TRANSF2D_NUM_ISAS
+} Transf2dIsa;
+
+/// generic affine 2d array transformation using a row-wise ordered float[6] transformation matrix
+/** arrSz is the number of floats in interleaved x|y arrays arrIn and arrOut, which may point to the same memory.
+ * Dispatches to the fastest kernel supported by the CPU at runtime. */
+extern void transf2d(const float transf[6], uint32_t arrSz, const float* arrIn, float* arrOut);
+/// selects a specific kernel, mainly for testing and benchmarking
+/** \return false if isa is not supported by this build or CPU */
+extern bool transf2dSelect(Transf2dIsa isa);
+/// returns the currently selected kernel
+extern Transf2dIsa transf2dIsa();
+/// returns a human-readable name of an instruction set variant
+extern const char* transf2dIsaName(Transf2dIsa isa);
@@ -97,6 +97,11 @@ int WindowOpen(int sizeX, int sizeY, WindowFlags windowFlags) {
 	wnd.eventHandler = NULL;
 	wnd.eventHandlerUserData = NULL;
 	wnd.vsync = (windowFlags & WINDOW_VSYNC) ? 1 : 0;
+	if(windowFlags & WINDOW_HEADLESS) { // render offscreen in software, e.g., on CI hosts lacking a GPU
+		SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+		SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+		wnd.vsync = 0;
+	}
 
 	if(SDL_Init(SDL_INIT_VIDEO)!=0) {
 		LogError("cannot initialize SDL video: %s", SDL_GetError());
@@ -166,7 +171,8 @@ int WindowOpen(int sizeX, int sizeY, WindowFlags windowFlags) {
 	else {
 		wnd.context = 0;
 		SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1");
-		uint32_t renderFlags = SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE;
+		uint32_t renderFlags = SDL_RENDERER_TARGETTEXTURE
+			| ((windowFlags & WINDOW_HEADLESS) ? SDL_RENDERER_SOFTWARE : SDL_RENDERER_ACCELERATED);
 		if(wnd.vsync)
 			renderFlags |= SDL_RENDERER_PRESENTVSYNC;
 		wnd.renderer = SDL_CreateRenderer(wnd.window, -1, renderFlags);
@@ -350,11 +356,7 @@ int WindowUpdate() {
 	if(ret)
 		return ret;
 
-	double tPrev = wnd.timestamp;
-	if(wnd.vsync)
-		SDL_Delay(1);
-	wnd.timestamp = (double)SDL_GetTicks64()/1000.0;
-	wnd.deltaT = wnd.timestamp-tPrev;
+	WindowUpdateTimestamp();
 	return 0;
 }
 
@@ -453,13 +455,25 @@ void WindowTitle(const char* str) {
 	SDL_SetWindowTitle(wnd.window, str);
 }
 
+/// returns seconds since the first call at performance counter resolution
+static double WindowClock() {
+	static uint64_t tickBase = 0;
+	static double tickSecs = 0.0;
+	const uint64_t tick = SDL_GetPerformanceCounter();
+	if(tickSecs == 0.0) {
+		tickBase = tick;
+		tickSecs = 1.0/(double)SDL_GetPerformanceFrequency();
+	}
+	return (tick-tickBase)*tickSecs;
+}
+
 double WindowTimestamp() {
 	return wnd.timestamp;
 }
 
 void WindowUpdateTimestamp() {
 	double tPrev = wnd.timestamp;
-	wnd.timestamp = (double)SDL_GetTicks64()/1000.0;
+	wnd.timestamp = WindowClock();
 	wnd.deltaT = wnd.timestamp-tPrev;
 }
 
@@ -471,6 +485,76 @@ void WindowSleep(double secs) {
 	SDL_Delay(secs*1000);
 }
 
+//--- frame pacing -----------------------------------------------
+
+typedef struct {
+	/// frame period and absolute deadline of the current frame in performance counter ticks, 0 if disabled
+	uint64_t period, deadline;
+	/// remaining time left to busy waiting instead of sleeping, covering SDL_Delay overshoot
+	uint64_t spinTicks;
+	double tickSecs;
+	uint32_t numFrames, numMissed;
+	double missSum, missMax;
+} FramePacer;
+
+static FramePacer pacer;
+/// portion of the remaining frame time not trusted to SDL_Delay's precision
+static const double pacerSpinSecs = 0.002;
+
+void WindowFramePacing(double maxFps) {
+	const uint64_t freq = SDL_GetPerformanceFrequency();
+	memset(&pacer, 0, sizeof(FramePacer));
+	pacer.tickSecs = 1.0/(double)freq;
+	if(maxFps <= 0.0)
+		return;
+	pacer.period = (uint64_t)(freq/maxFps);
+	pacer.spinTicks = (uint64_t)(freq*pacerSpinSecs);
+}
+
+double WindowPaceFrame() {
+	if(!pacer.period)
+		return 0.0;
+	uint64_t now = SDL_GetPerformanceCounter();
+	if(!pacer.deadline)
+		pacer.deadline = now + pacer.period;
+	++pacer.numFrames;
+	double miss = 0.0;
+	if(now <= pacer.deadline) { // frames finishing right at their deadline are on time
+		// sleep for most of the remaining time, then spin up to the deadline:
+		uint64_t remaining = pacer.deadline - now;
+		if(remaining > pacer.spinTicks) {
+			const uint32_t ms = (uint32_t)((remaining - pacer.spinTicks)*pacer.tickSecs*1000.0);
+			if(ms)
+				SDL_Delay(ms);
+		}
+		do
+			now = SDL_GetPerformanceCounter();
+		while(now < pacer.deadline);
+		pacer.deadline += pacer.period;
+	}
+	else {
+		miss = (now - pacer.deadline)*pacer.tickSecs;
+		++pacer.numMissed;
+		pacer.missSum += miss;
+		if(miss > pacer.missMax)
+			pacer.missMax = miss;
+		// catch up on a slightly late frame, but restart the schedule after a stall instead of rushing frames:
+		pacer.deadline = (now - pacer.deadline < pacer.period) ? pacer.deadline + pacer.period : now + pacer.period;
+	}
+	return miss;
+}
+
+void WindowFramePacingStats(uint32_t* numFrames, uint32_t* numMissed, double* missMean, double* missMax) {
+	if(numFrames)
+		*numFrames = pacer.numFrames;
+	if(numMissed)
+		*numMissed = pacer.numMissed;
+	if(missMean)
+		*missMean = pacer.numMissed ? pacer.missSum/pacer.numMissed : 0.0;
+	if(missMax)
+		*missMax = pacer.missMax;
+}
+
 void WindowClearColor(uint32_t color) {
 	wnd.clearColor = color;
 	if(wnd.renderer) {
@@ -10,6 +10,7 @@ typedef enum {
     WINDOW_RESIZABLE = (1<<3),
     WINDOW_LANDSCAPE = (1<<4),
     WINDOW_PORTRAIT = (1<<5),
+    WINDOW_HEADLESS = (1<<6),
 } WindowFlags;
 
 /// opens an SDL window
@@ -56,6 +57,13 @@ void WindowUpdateTimestamp();
 double WindowDeltaT();
 /// sleeps for at least n seconds
 void WindowSleep(double secs);
+/// sets the frame rate WindowPaceFrame() limits to, 0 disables pacing
+void WindowFramePacing(double maxFps);
+/// waits for the absolute deadline of the current frame by sleeping and finally spinning
+/** returns by how many seconds the frame missed its deadline, 0 if it was on time */
+double WindowPaceFrame();
+/// returns the number of paced frames, how many of them missed their deadlines, and by how many seconds on average and at most
+void WindowFramePacingStats(uint32_t* numFrames, uint32_t* numMissed, double* missMean, double* missMax);
 
 /// sets clear color
 void WindowClearColor(uint32_t color);